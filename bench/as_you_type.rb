@@ -0,0 +1,28 @@
+# frozen_string_literal: true
+
+require 'bundler/setup'
+require 'mini_phone'
+
+Bundler.require(:bench)
+
+# Typing the 12 digits of "+44 20 7031 3000" one character at a time, against
+# re-parsing the whole prefix on every keystroke.
+keystrokes = '+442070313000'.each_char.to_a
+formatter = MiniPhone::AsYouType.new('GB')
+
+Benchmark.ips do |x|
+  x.report('AsYouType#input_digit') do
+    formatter.clear
+    keystrokes.each { |c| formatter.input_digit(c) }
+  end
+
+  x.report('MiniPhone.parse(prefix).national') do
+    prefix = +''
+    keystrokes.each do |c|
+      prefix << c
+      MiniPhone.parse(prefix, 'GB').national
+    end
+  end
+
+  x.compare!
+end
@@ -0,0 +1,46 @@
+# frozen_string_literal: true
+
+require 'bundler/setup'
+require 'mini_phone'
+require 'etc'
+
+Bundler.require(:bench)
+
+numbers = Array.new(20_000) do |i|
+  case i % 4
+  when 0 then "+1 404-384-#{format('%04d', i % 10_000)}"
+  when 1 then "(404) 555-#{format('%04d', i % 10_000)}"
+  when 2 then "+44 1434 #{format('%06d', i)}"
+  else '444'
+  end
+end
+
+thread_counts = [1, 2, 4, 8, 16, 32].select { |n| n <= Etc.nprocessors }
+
+Benchmark.ips do |x|
+  x.report('MiniPhone: valid? (20k, loop)') do
+    numbers.each { |n| MiniPhone.valid_for_country?(n, 'US') }
+  end
+
+  thread_counts.each do |threads|
+    x.report("MiniPhone: valid_many? (20k, #{threads} threads)") do
+      MiniPhone.valid_many?(numbers, 'US', threads: threads)
+    end
+  end
+
+  x.compare!
+end
+
+Benchmark.ips do |x|
+  x.report('MiniPhone: parse.e164 (20k, loop)') do
+    numbers.each { |n| MiniPhone.parse(n, 'US').e164 }
+  end
+
+  thread_counts.each do |threads|
+    x.report("MiniPhone: e164_many (20k, #{threads} threads)") do
+      MiniPhone.e164_many(numbers, 'US', threads: threads)
+    end
+  end
+
+  x.compare!
+end
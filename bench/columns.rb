@@ -0,0 +1,38 @@
+# frozen_string_literal: true
+
+require 'bundler/setup'
+require 'mini_phone'
+
+Bundler.require(:bench)
+
+numbers = Array.new(20_000) do |i|
+  case i % 4
+  when 0 then "+1 404-384-#{format('%04d', i % 10_000)}"
+  when 1 then "(404) 555-#{format('%04d', i % 10_000)}"
+  when 2 then "+44 1434 #{format('%06d', i)}"
+  else '444'
+  end
+end
+
+fields = %i[e164 country_code type valid]
+
+Benchmark.ips do |x|
+  x.report('MiniPhone: parse_many + accessors (20k)') do
+    MiniPhone.parse_many(numbers, 'US').each do |pn|
+      pn.e164
+      pn.country_code
+      pn.type
+      pn.valid?
+    end
+  end
+
+  x.report('MiniPhone: parse_columns (20k)') do
+    MiniPhone.parse_columns(numbers, 'US', fields: fields)
+  end
+
+  x.report('MiniPhone: parse_columns (20k, 4 threads)') do
+    MiniPhone.parse_columns(numbers, 'US', fields: fields, threads: 4)
+  end
+
+  x.compare!
+end
@@ -11,6 +11,10 @@ Benchmark.ips do |x|
     pn.e164
   end
 
+  x.report('MiniPhone: one-shot e164') do
+    MiniPhone.e164('+1 404-384-1384')
+  end
+
   x.report('Phonelib: e164') do
     pn = Phonelib.parse('+1 404-384-1384')
     pn.e164
@@ -23,3 +27,27 @@ Benchmark.ips do |x|
 
   x.compare!
 end
+
+def allocations_per_op(iterations = 10_000)
+  GC.start
+  before = GC.stat(:total_allocated_objects)
+  iterations.times { yield }
+  (GC.stat(:total_allocated_objects) - before) / iterations.to_f
+end
+
+puts
+puts 'Ruby object allocations per e164:'
+{
+  'MiniPhone' => -> { MiniPhone::PhoneNumber.new('+1 404-384-1384').e164 },
+  'MiniPhone.e164' => -> { MiniPhone.e164('+1 404-384-1384') },
+  'Phonelib' => -> { Phonelib.parse('+1 404-384-1384').e164 },
+  'TelephoneNumber' => -> { TelephoneNumber.parse('+1 404-384-1384').e164_number }
+}.each do |name, block|
+  puts format('  %-16<name>s %<count>.1f', name: "#{name}:", count: allocations_per_op(&block))
+end
+
+stats = MiniPhone::PhoneNumber.pool_stats
+total = stats[:allocated] + stats[:recycled]
+puts
+puts "MiniPhone native allocations: #{stats[:allocated]} malloc'd, #{stats[:recycled]} recycled " \
+     "(#{(100.0 * stats[:recycled] / [total, 1].max).round(1)}% served from the free list)"
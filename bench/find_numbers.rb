@@ -0,0 +1,40 @@
+# frozen_string_literal: true
+
+require 'bundler/setup'
+require 'mini_phone'
+require 'etc'
+
+Bundler.require(:bench)
+
+words = %w[please call me back about the ticket regarding my order thanks support team today tomorrow]
+random = Random.new(42)
+
+# ~50kb of text per document, with a phone number every 40 words or so
+documents = Array.new(20) do
+  Array.new(8_000) do |i|
+    if (i % 40).zero?
+      "(404) #{random.rand(200..999)}-#{format('%04d', random.rand(10_000))}"
+    else
+      words.sample(random: random)
+    end
+  end.join(' ')
+end
+
+regex = /\(?\d{3}\)?[\s.-]?\d{3}[\s.-]?\d{4}/
+threads = [Etc.nprocessors, 8].min
+
+Benchmark.ips do |x|
+  x.report('Ruby: regex + MiniPhone.parse') do
+    documents.each { |doc| doc.scan(regex).map { |hit| MiniPhone.parse(hit, 'US') }.select(&:valid?) }
+  end
+
+  x.report('MiniPhone: find_numbers') do
+    documents.each { |doc| MiniPhone.find_numbers(doc, 'US') }
+  end
+
+  x.report("MiniPhone: find_numbers_many (#{threads} threads)") do
+    MiniPhone.find_numbers_many(documents, 'US', threads: threads)
+  end
+
+  x.compare!
+end
@@ -0,0 +1,29 @@
+# frozen_string_literal: true
+
+require 'bundler/setup'
+require 'mini_phone'
+
+Bundler.require(:bench)
+
+# The PhoneNumber accessors are memoized, so this goes through the one-shot
+# MiniPhone.normalize. :e164 is the baseline (parsing plus the cheapest format).
+# `rake bench:native` has the same formats without Ruby, next to the single
+# pattern FormatByPattern they replaced (raw_national_before and
+# dasherized_international_before) and to libphonenumber formatting with the
+# region's own patterns (dasherized_national_reference).
+numbers = {
+  'US' => '+1 404-384-1384',
+  'GB' => '+44 1434 634996'
+}
+
+Benchmark.ips do |x|
+  numbers.each do |region, number|
+    %i[e164 raw_national dasherized_national dasherized_international national].each do |format|
+      x.report("#{region}: #{format}") do
+        MiniPhone.normalize(number, format: format)
+      end
+    end
+  end
+
+  x.compare!
+end
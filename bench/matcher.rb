@@ -0,0 +1,22 @@
+# frozen_string_literal: true
+
+require 'bundler/setup'
+require 'mini_phone'
+
+Bundler.require(:bench)
+
+references = Array.new(1_000) { |i| MiniPhone.parse("+1 404 555 #{format('%04d', i)}") }
+candidates = Array.new(1_000) { |i| MiniPhone.parse("+1 404 555 #{format('%04d', i * 7 % 2_000)}") }
+matcher = MiniPhone::Matcher.new(references)
+
+Benchmark.ips do |x|
+  x.report('MiniPhone: PhoneNumber#== (1k x 1k)') do
+    candidates.map { |candidate| references.any? { |reference| reference == candidate } }
+  end
+
+  x.report('MiniPhone: Matcher#match (1k x 1k)') do
+    matcher.match(candidates)
+  end
+
+  x.compare!
+end
@@ -0,0 +1,35 @@
+# frozen_string_literal: true
+
+require 'bundler/setup'
+require 'mini_phone'
+
+Bundler.require(:bench)
+
+inputs = {
+  'ASCII' => '+1 (404) 384-1384',
+  'long ASCII' => '+1 (404) 384-1384 ext. 1234, or +44 1434 634996 after 6pm',
+  'full-width' => '＋１ (４０４) ３８４-１３８４',
+  'Arabic-Indic' => '+١ (٤٠٤) ٣٨٤-١٣٨٤'
+}
+
+inputs.each do |name, input|
+  buffer = +''
+
+  Benchmark.ips do |x|
+    x.report("normalize_digits_only (#{name})") { MiniPhone.normalize_digits_only(input) }
+    x.report("normalize_digits_only, buffer (#{name})") { MiniPhone.normalize_digits_only(input, buffer) }
+    x.report("Ruby: delete('^0-9') (#{name})") { input.delete('^0-9') }
+
+    x.compare!
+  end
+end
+
+numbers = Array.new(100_000) { |i| inputs.values[i % inputs.size] }
+
+Benchmark.ips do |x|
+  x.report('map { normalize_digits_only } (100k)') { numbers.map { |n| MiniPhone.normalize_digits_only(n) } }
+  x.report('normalize_digits_many (100k)') { MiniPhone.normalize_digits_many(numbers) }
+  x.report('normalize_digits_many, 4 threads (100k)') { MiniPhone.normalize_digits_many(numbers, threads: 4) }
+
+  x.compare!
+end
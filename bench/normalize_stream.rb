@@ -0,0 +1,55 @@
+# frozen_string_literal: true
+
+require 'bundler/setup'
+require 'mini_phone'
+require 'stringio'
+require 'tempfile'
+
+Bundler.require(:bench)
+
+csv = +"id,phone,name\n"
+
+100_000.times do |i|
+  phone = case i % 4
+          when 0 then "+1 404-384-#{format('%04d', i % 10_000)}"
+          when 1 then "(404) 555-#{format('%04d', i % 10_000)}"
+          when 2 then "+44 1434 #{format('%06d', i)}"
+          else '444'
+          end
+
+  csv << "#{i},#{phone},someone\n"
+end
+
+Tempfile.create('normalize_stream') do |file|
+  file.write(csv)
+  file.flush
+
+  stats = MiniPhone.normalize_stream(file.path, StringIO.new, column: 1, country: 'US', headers: true)
+  puts "normalize_stream: #{stats[:rows_per_sec].round} rows/sec"
+
+  Benchmark.ips do |x|
+    x.report('Ruby: parse(x).e164 per line (100k rows)') do
+      out = StringIO.new
+
+      File.foreach(file.path).with_index do |line, i|
+        next out << line if i.zero?
+
+        fields = line.chomp.split(',', -1)
+        fields[1] = MiniPhone.parse(fields[1], 'US').e164.to_s
+        out << fields.join(',') << "\n"
+      end
+    end
+
+    x.report('MiniPhone: normalize_stream, IO (100k rows)') do
+      File.open(file.path, 'rb') do |input|
+        MiniPhone.normalize_stream(input, StringIO.new, column: 1, country: 'US', headers: true)
+      end
+    end
+
+    x.report('MiniPhone: normalize_stream, mmap (100k rows)') do
+      MiniPhone.normalize_stream(file.path, StringIO.new, column: 1, country: 'US', headers: true)
+    end
+
+    x.compare!
+  end
+end
@@ -0,0 +1,35 @@
+# frozen_string_literal: true
+
+require 'bundler/setup'
+require 'mini_phone'
+
+Bundler.require(:bench)
+
+number = MiniPhone::PhoneNumber.new('+1 404-384-1384')
+packed = number.to_packed
+packed_with_raw_input = number.to_packed(raw_input: true)
+packed_int = number.to_packed_int
+e164 = number.e164
+
+puts "to_packed: #{packed.bytesize} bytes, with raw input: #{packed_with_raw_input.bytesize} bytes, " \
+     "to_packed_int: #{packed_int}"
+
+Benchmark.ips do |x|
+  x.report('MiniPhone: parse(e164)') do
+    MiniPhone.parse(e164).e164
+  end
+
+  x.report('MiniPhone: from_packed(string)') do
+    MiniPhone::PhoneNumber.from_packed(packed).e164
+  end
+
+  x.report('MiniPhone: from_packed(string with raw input)') do
+    MiniPhone::PhoneNumber.from_packed(packed_with_raw_input).e164
+  end
+
+  x.report('MiniPhone: from_packed(integer)') do
+    MiniPhone::PhoneNumber.from_packed(packed_int).e164
+  end
+
+  x.compare!
+end
@@ -0,0 +1,69 @@
+# frozen_string_literal: true
+
+# Generates the corpus shared by the Ruby and native benchmark suites: a mix of
+# regions and formats, with a share of near misses and junk, written as
+# "REGION\tinput" lines. The same seed always gives the same corpus.
+#
+#   ruby bench/suite/corpus.rb tmp/bench/corpus.tsv [size] [seed]
+
+module MiniPhoneBench
+  module Corpus
+    SAMPLES = {
+      'US' => ['+1 404-384-1384', '(650) 253-0000', '404.384.1384', '1-800-221-1212', '+1 (415) 555-2671 ext. 12'],
+      'GB' => ['+44 1434 634996', '020 7946 0958', '07400 123456', '+44 (0) 20 7946 0958'],
+      'DE' => ['+49 30 123456', '030 1234567', '+49 1512 3456789', '0151 23456789'],
+      'FR' => ['+33 1 23 45 67 89', '06 12 34 56 78', '+33 6 12 34 56 78'],
+      'IN' => ['+91 98765 43210', '022 2345 6789', '09876543210'],
+      'BR' => ['+55 11 91234-5678', '(21) 2345-6789', '+55 (11) 3456-7890'],
+      'JP' => ['+81 3-1234-5678', '090-1234-5678', '03 1234 5678'],
+      'AU' => ['+61 2 9876 5432', '0412 345 678', '(02) 9876 5432']
+    }.freeze
+
+    JUNK = ['', '+', '444', 'asdf', '1-800-FLOWERS', '+999 123 456 789', '12345678901234567890', 'call me maybe',
+            '☎ 404 384 1384'].freeze
+
+    module_function
+
+    def generate(size, seed: 1234)
+      random = Random.new(seed)
+      regions = SAMPLES.keys
+
+      Array.new(size) do
+        region = regions[random.rand(regions.size)]
+        [region, sample(region, random)]
+      end
+    end
+
+    def sample(region, random)
+      case random.rand(10)
+      when 0..5 then SAMPLES[region].sample(random: random)
+      when 6..7 then near_miss(SAMPLES[region].sample(random: random), random)
+      else JUNK.sample(random: random)
+      end
+    end
+
+    # Swaps or drops a digit, which may or may not leave a valid number
+    def near_miss(number, random)
+      digits = number.each_char.with_index.select { |c, _| c.match?(/\d/) }.map(&:last)
+      number = number.dup
+      number[digits[random.rand(digits.size)]] = random.rand(2).zero? ? random.rand(10).to_s : ''
+      number
+    end
+
+    def write(path, size: 10_000, seed: 1234)
+      lines = generate(size, seed: seed).map { |region, input| "#{region}\t#{input}\n" }
+      File.write(path, lines.join, encoding: Encoding::UTF_8)
+    end
+
+    def read(path)
+      File.readlines(path, chomp: true, encoding: Encoding::UTF_8).map { |line| line.split("\t", 2) }
+    end
+  end
+end
+
+if $PROGRAM_NAME == __FILE__
+  path, size, seed = ARGV
+  abort "usage: #{$PROGRAM_NAME} path [size] [seed]" unless path
+
+  MiniPhoneBench::Corpus.write(path, size: Integer(size || 10_000), seed: Integer(seed || 1234))
+end
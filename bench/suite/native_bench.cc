@@ -0,0 +1,302 @@
+// Google Benchmark suite for the native side of the extension: the same
+// libphonenumber calls mini_phone.cc makes, plus the extension's own C++
+// modules, without any Ruby in the way. Built and run by `rake bench:native`.
+//
+//   native_bench [--benchmark_out=native.json --benchmark_out_format=json] corpus.tsv
+//
+// Every benchmark iteration handles one corpus entry, so the reported time is
+// per operation. Each benchmark also reports heap allocations per operation
+// and the peak RSS of the process.
+
+#include "ascii_digits.h"
+#include "number_format.h"
+#include "number_shape.h"
+#include "phonenumbers/phonemetadata.pb.h"
+#include "phonenumbers/phonenumberutil.h"
+#include "region_codes.h"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+using namespace ::i18n::phonenumbers;
+using google::protobuf::RepeatedPtrField;
+
+static std::atomic<uint64_t> allocations{0};
+
+void *operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+
+  if (void *ptr = malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+struct CorpusEntry {
+  std::string region_code;
+  std::string input;
+  PhoneNumber number;
+  bool parsed_ok;
+};
+
+static std::vector<CorpusEntry> corpus;
+
+static bool load_corpus(const char *path) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  std::ifstream file(path);
+  std::string line;
+
+  while (std::getline(file, line)) {
+    size_t tab = line.find('\t');
+
+    if (tab == std::string::npos) {
+      continue;
+    }
+
+    CorpusEntry entry;
+    entry.region_code = line.substr(0, tab);
+    entry.input = line.substr(tab + 1);
+    entry.parsed_ok = phone_util.ParseAndKeepRawInput(entry.input, entry.region_code, &entry.number) ==
+                      PhoneNumberUtil::NO_PARSING_ERROR;
+    corpus.push_back(std::move(entry));
+  }
+
+  return !corpus.empty();
+}
+
+// Runs `operation` over the corpus, one entry per iteration
+template <typename Operation> static void run(benchmark::State &state, Operation operation) {
+  uint64_t allocations_before = allocations.load(std::memory_order_relaxed);
+  size_t i = 0;
+
+  for (auto _ : state) {
+    operation(corpus[i]);
+
+    if (++i == corpus.size()) {
+      i = 0;
+    }
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  state.counters["allocs_per_op"] = benchmark::Counter(
+      static_cast<double>(allocations.load(std::memory_order_relaxed) - allocations_before),
+      benchmark::Counter::kAvgIterations);
+  state.counters["max_rss_kb"] = static_cast<double>(usage.ru_maxrss);
+}
+
+static void BM_Parse(benchmark::State &state) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  PhoneNumber number;
+
+  run(state, [&](const CorpusEntry &entry) {
+    benchmark::DoNotOptimize(phone_util.ParseAndKeepRawInput(entry.input, entry.region_code, &number));
+  });
+}
+
+// What MiniPhone.valid_for_country? does, minus the parse cache
+static void BM_Valid(benchmark::State &state) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  PhoneNumber number;
+
+  run(state, [&](const CorpusEntry &entry) {
+    uint64_t national_number;
+    bool region_valid = region_code_valid_for_parsing(entry.region_code.data(), entry.region_code.size());
+    bool valid = false;
+
+    if (number_shape(entry.input.data(), entry.input.size(), region_valid, &national_number) != NUMBER_SHAPE_JUNK &&
+        phone_util.ParseAndKeepRawInput(entry.input, entry.region_code, &number) == PhoneNumberUtil::NO_PARSING_ERROR) {
+      valid = phone_util.IsValidNumberForRegion(number, entry.region_code);
+    }
+
+    benchmark::DoNotOptimize(valid);
+  });
+}
+
+static void BM_Possible(benchmark::State &state) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+
+  run(state, [&](const CorpusEntry &entry) { benchmark::DoNotOptimize(phone_util.IsPossibleNumber(entry.number)); });
+}
+
+static void BM_Type(benchmark::State &state) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+
+  run(state, [&](const CorpusEntry &entry) { benchmark::DoNotOptimize(phone_util.GetNumberType(entry.number)); });
+}
+
+static void BM_AreaCode(benchmark::State &state) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  std::string national_significant_number;
+
+  run(state, [&](const CorpusEntry &entry) {
+    national_significant_number.clear();
+    phone_util.GetNationalSignificantNumber(entry.number, &national_significant_number);
+    int length = phone_util.GetLengthOfGeographicalAreaCode(entry.number);
+    benchmark::DoNotOptimize(national_significant_number.substr(0, length > 0 ? length : 0));
+  });
+}
+
+static void BM_Format(benchmark::State &state, NumberFormatStyle style) {
+  std::string formatted;
+
+  run(state, [&](const CorpusEntry &entry) {
+    if (entry.parsed_ok) {
+      number_format(entry.number, style, &formatted);
+      benchmark::DoNotOptimize(formatted.data());
+    }
+  });
+}
+
+// How raw_national and dasherized_international were formatted before the
+// per-country table: FormatByPattern with one fixed NANP pattern. Numbers
+// outside of NANP came out grouped wrong, but it's the baseline for speed.
+static void BM_FormatBefore(benchmark::State &state, NumberFormatStyle style) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  RepeatedPtrField<NumberFormat> formats;
+  NumberFormat *format = formats.Add();
+  std::string national;
+  std::string formatted;
+
+  format->set_pattern("(\\d{3})(\\d{3})(\\d{4})");
+  format->set_format(style == NUMBER_FORMAT_RAW_NATIONAL ? "$1$2$3" : "$1-$2-$3");
+
+  run(state, [&](const CorpusEntry &entry) {
+    if (!entry.parsed_ok) {
+      return;
+    }
+
+    if (style == NUMBER_FORMAT_RAW_NATIONAL) {
+      formatted.clear();
+      phone_util.FormatByPattern(entry.number, PhoneNumberUtil::NATIONAL, formats, &formatted);
+    } else {
+      national.clear();
+      phone_util.FormatByPattern(entry.number, PhoneNumberUtil::NATIONAL, formats, &national);
+      formatted.assign(std::to_string(entry.number.country_code()));
+      formatted.push_back('-');
+      formatted.append(national);
+    }
+
+    benchmark::DoNotOptimize(formatted.data());
+  });
+}
+
+// The same output as dasherized_national, with libphonenumber picking the
+// format and running the regexes
+static void BM_DasherizedReference(benchmark::State &state) {
+  std::string formatted;
+
+  run(state, [&](const CorpusEntry &entry) {
+    if (entry.parsed_ok) {
+      number_format_dasherized_reference(entry.number, &formatted);
+      benchmark::DoNotOptimize(formatted.data());
+    }
+  });
+}
+
+// PhoneNumber#== against the previous entry
+static void BM_Equal(benchmark::State &state) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  const PhoneNumber *previous = &corpus.back().number;
+
+  run(state, [&](const CorpusEntry &entry) {
+    benchmark::DoNotOptimize(entry.number.raw_input() == previous->raw_input() ||
+                             phone_util.IsNumberMatch(entry.number, *previous) == PhoneNumberUtil::EXACT_MATCH);
+    previous = &entry.number;
+  });
+}
+
+static void BM_NormalizeDigitsOnly(benchmark::State &state) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  std::string number;
+
+  run(state, [&](const CorpusEntry &entry) {
+    number.assign(entry.input);
+    phone_util.NormalizeDigitsOnly(&number);
+    benchmark::DoNotOptimize(number.data());
+  });
+}
+
+// The ASCII fast path in front of NormalizeDigitsOnly, falling back to it for
+// non-ASCII input the way mini_phone.cc does
+static void BM_AsciiDigits(benchmark::State &state) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  std::string number;
+
+  run(state, [&](const CorpusEntry &entry) {
+    number.resize(entry.input.size());
+
+    size_t len = ascii_digits_copy(entry.input.data(), entry.input.size(), &number[0]);
+
+    if (len == ASCII_DIGITS_NOT_ASCII) {
+      number.assign(entry.input);
+      phone_util.NormalizeDigitsOnly(&number);
+    } else {
+      number.resize(len);
+    }
+
+    benchmark::DoNotOptimize(number.data());
+  });
+}
+
+static void register_benchmarks() {
+  static const struct {
+    const char *name;
+    NumberFormatStyle style;
+  } formats[] = {
+      {"e164", NUMBER_FORMAT_E164},
+      {"national", NUMBER_FORMAT_NATIONAL},
+      {"international", NUMBER_FORMAT_INTERNATIONAL},
+      {"rfc3966", NUMBER_FORMAT_RFC3966},
+      {"raw_national", NUMBER_FORMAT_RAW_NATIONAL},
+      {"dasherized_national", NUMBER_FORMAT_DASHERIZED_NATIONAL},
+      {"raw_international", NUMBER_FORMAT_RAW_INTERNATIONAL},
+      {"dasherized_international", NUMBER_FORMAT_DASHERIZED_INTERNATIONAL},
+  };
+
+  benchmark::RegisterBenchmark("parse", BM_Parse);
+  benchmark::RegisterBenchmark("valid?", BM_Valid);
+  benchmark::RegisterBenchmark("possible?", BM_Possible);
+  benchmark::RegisterBenchmark("type", BM_Type);
+  benchmark::RegisterBenchmark("area_code", BM_AreaCode);
+  benchmark::RegisterBenchmark("==", BM_Equal);
+  benchmark::RegisterBenchmark("normalize_digits_only", BM_NormalizeDigitsOnly);
+  benchmark::RegisterBenchmark("ascii_digits", BM_AsciiDigits);
+
+  for (const auto &format : formats) {
+    benchmark::RegisterBenchmark(format.name, BM_Format, format.style);
+  }
+
+  benchmark::RegisterBenchmark("raw_national_before", BM_FormatBefore, NUMBER_FORMAT_RAW_NATIONAL);
+  benchmark::RegisterBenchmark("dasherized_international_before", BM_FormatBefore,
+                               NUMBER_FORMAT_DASHERIZED_INTERNATIONAL);
+  benchmark::RegisterBenchmark("dasherized_national_reference", BM_DasherizedReference);
+}
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+
+  if (argc != 2 || !load_corpus(argv[1])) {
+    fprintf(stderr, "usage: %s [benchmark flags] corpus.tsv\n", argv[0]);
+    return 1;
+  }
+
+  number_format_setup();
+  register_benchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+# frozen_string_literal: true
+
+# Times every PhoneNumber operation over the generated corpus and prints the
+# results as JSON (ns/op, allocations/op and RSS), so runs can be compared
+# between releases.
+#
+#   ruby bench/suite/suite.rb tmp/bench/corpus.tsv [--output results.json] [--rounds 5]
+
+require 'bundler/setup'
+require 'mini_phone'
+require 'get_process_mem'
+require 'json'
+require 'optparse'
+require_relative 'corpus'
+
+module MiniPhoneBench
+  class Suite
+    FORMATS = %i[e164 national international rfc3966 raw_national dasherized_national raw_international
+                 dasherized_international].freeze
+
+    def initialize(corpus, rounds:)
+      @corpus = corpus
+      @inputs = corpus.map(&:last)
+      @rounds = rounds
+    end
+
+    def operations
+      {
+        'parse' => -> { @corpus.each { |region, input| MiniPhone::PhoneNumber.new(input, region) } },
+        'valid?' => -> { @corpus.each { |region, input| MiniPhone.valid_for_country?(input, region) } },
+        'normalize_digits_only' => -> { @inputs.each { |input| MiniPhone.normalize_digits_only(input) } },
+        'possible?' => accessor(:possible?),
+        'type' => accessor(:type),
+        'area_code' => accessor(:area_code),
+        '==' => ->(numbers) { numbers.each_index { |i| numbers[i] == numbers[i - 1] } }
+      }.merge(FORMATS.to_h { |format| [format.to_s, accessor(format)] })
+    end
+
+    def run
+      operations.map { |name, operation| measure(name, operation) }
+    end
+
+    private
+
+    # The accessors are memoized, so operations taking numbers get freshly
+    # parsed ones every round (parsed outside of the timed section).
+    def accessor(name)
+      ->(numbers) { numbers.each(&name) }
+    end
+
+    def fresh_numbers
+      @corpus.map { |region, input| MiniPhone::PhoneNumber.new(input, region) }
+    end
+
+    def measure(name, operation)
+      timings = Array.new(@rounds) { time_round(operation) }
+      best = timings.min_by(&:first)
+
+      {
+        name: name,
+        ns_per_op: (best[0] * 1e9 / @corpus.size).round(1),
+        ops_per_sec: (@corpus.size / best[0]).round,
+        allocations_per_op: (best[1].to_f / @corpus.size).round(2),
+        rss_mb: GetProcessMem.new.mb.round(1)
+      }
+    end
+
+    def time_round(operation)
+      numbers = fresh_numbers if operation.arity == 1
+      GC.start
+      allocations = GC.stat(:total_allocated_objects)
+      start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      numbers ? operation.call(numbers) : operation.call
+      elapsed = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+
+      [elapsed, GC.stat(:total_allocated_objects) - allocations]
+    end
+  end
+end
+
+if $PROGRAM_NAME == __FILE__
+  options = { rounds: 5 }
+  path = OptionParser.new do |opts|
+    opts.on('--output PATH') { |value| options[:output] = value }
+    opts.on('--rounds N', Integer) { |value| options[:rounds] = value }
+  end.parse!(ARGV).first
+  abort "usage: #{$PROGRAM_NAME} corpus.tsv [--output PATH] [--rounds N]" unless path
+
+  corpus = MiniPhoneBench::Corpus.read(path)
+  report = {
+    mini_phone: MiniPhone::VERSION,
+    ruby: RUBY_DESCRIPTION,
+    corpus: { path: path, size: corpus.size, regions: corpus.map(&:first).tally },
+    results: MiniPhoneBench::Suite.new(corpus, rounds: options[:rounds]).run
+  }
+  json = JSON.pretty_generate(report)
+
+  options[:output] ? File.write(options[:output], json) : puts(json)
+end
@@ -0,0 +1,40 @@
+# frozen_string_literal: true
+
+# Reports how much memory MiniPhone::PhoneNumber objects take once all of
+# their memoized accessors have been called, both per object (as seen by
+# ObjectSpace) and for the whole process when holding many of them.
+#
+#   ruby debug/memory_plot/object_size.rb [count]
+
+require 'bundler/setup'
+require 'mini_phone'
+require 'objspace'
+require 'get_process_mem'
+
+ACCESSORS = %i[e164 national international rfc3966 raw_national dasherized_national raw_international
+               dasherized_international country_code region_code type area_code valid? possible?].freeze
+
+count = Integer(ARGV.first || 1_000_000)
+
+def touch(phone_number)
+  ACCESSORS.each { |name| phone_number.public_send(name) }
+  phone_number
+end
+
+sample = touch(MiniPhone::PhoneNumber.new('+1 404 388 1299'))
+
+puts "memsize_of(PhoneNumber):   #{ObjectSpace.memsize_of(sample)} bytes"
+puts "instance variables:        #{sample.instance_variables.size}"
+
+4.times { GC.start }
+before = GetProcessMem.new.bytes
+
+numbers = Array.new(count) { |i| touch(MiniPhone::PhoneNumber.new("+1 404 388 #{format('%04d', i % 10_000)}")) }
+
+4.times { GC.start }
+after = GetProcessMem.new.bytes
+
+puts "RSS for #{count} numbers: #{((after - before) / 1024.0 / 1024.0).round(1)} MB " \
+     "(#{((after - before) / count.to_f).round(1)} bytes per number)"
+
+numbers.clear
@@ -0,0 +1,89 @@
+#include "ascii_digits.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Copies the bytes of a chunk whose bit is set in `mask`
+static inline size_t ascii_digits_compact(const unsigned char *chunk, uint32_t mask, char *out) {
+  size_t n = 0;
+
+  while (mask != 0) {
+    out[n++] = static_cast<char>(chunk[__builtin_ctz(mask)]);
+    mask &= mask - 1;
+  }
+
+  return n;
+}
+
+size_t ascii_digits_copy(const char *str, size_t len, char *out) {
+  const unsigned char *bytes = reinterpret_cast<const unsigned char *>(str);
+  size_t i = 0;
+  size_t n = 0;
+
+#if defined(__AVX2__)
+  const __m256i before_zero_256 = _mm256_set1_epi8('0' - 1);
+  const __m256i after_nine_256 = _mm256_set1_epi8('9' + 1);
+
+  for (; i + 32 <= len; i += 32) {
+    // Loaded before anything is stored, so `out` can overlap this chunk
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes + i));
+
+    if (_mm256_movemask_epi8(chunk) != 0) {
+      return ASCII_DIGITS_NOT_ASCII;
+    }
+
+    __m256i is_digit =
+        _mm256_and_si256(_mm256_cmpgt_epi8(chunk, before_zero_256), _mm256_cmpgt_epi8(after_nine_256, chunk));
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(is_digit));
+
+    if (mask == UINT32_MAX) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + n), chunk);
+      n += 32;
+    } else {
+      n += ascii_digits_compact(bytes + i, mask, out + n);
+    }
+  }
+#endif
+
+#if defined(__SSE2__)
+  const __m128i before_zero = _mm_set1_epi8('0' - 1);
+  const __m128i after_nine = _mm_set1_epi8('9' + 1);
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+
+    if (_mm_movemask_epi8(chunk) != 0) {
+      return ASCII_DIGITS_NOT_ASCII;
+    }
+
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, before_zero), _mm_cmplt_epi8(chunk, after_nine));
+    uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(is_digit));
+
+    if (mask == 0xffff) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + n), chunk);
+      n += 16;
+    } else {
+      n += ascii_digits_compact(bytes + i, mask, out + n);
+    }
+  }
+#endif
+
+  for (; i < len; i++) {
+    unsigned char c = bytes[i];
+
+    if (c >= 0x80) {
+      return ASCII_DIGITS_NOT_ASCII;
+    }
+
+    if (c >= '0' && c <= '9') {
+      out[n++] = static_cast<char>(c);
+    }
+  }
+
+  return n;
+}
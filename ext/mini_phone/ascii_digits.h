@@ -0,0 +1,20 @@
+#ifndef MINI_PHONE_ASCII_DIGITS_H
+#define MINI_PHONE_ASCII_DIGITS_H 1
+
+#include <cstddef>
+#include <cstdint>
+
+// Returned by ascii_digits_copy for input with non-ASCII bytes
+static const size_t ASCII_DIGITS_NOT_ASCII = SIZE_MAX;
+
+// Copies the ASCII digits of `str` to `out`, which must have room for `len`
+// bytes, and returns how many were copied. For ASCII input this is exactly what
+// libphonenumber's NormalizeDigitsOnly keeps, without decoding UTF-8 one code
+// point at a time. Works 32 bytes at a time with AVX2 or 16 with SSE2.
+//
+// Returns ASCII_DIGITS_NOT_ASCII once a byte >= 0x80 is seen: full-width,
+// Arabic-Indic and other non-ASCII digits need NormalizeDigitsOnly. `out` may
+// be `str` itself, digits are only ever moved towards the start.
+size_t ascii_digits_copy(const char *str, size_t len, char *out);
+
+#endif /* MINI_PHONE_ASCII_DIGITS_H */
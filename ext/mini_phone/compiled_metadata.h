@@ -0,0 +1,14 @@
+#ifndef MINI_PHONE_COMPILED_METADATA_H
+#define MINI_PHONE_COMPILED_METADATA_H 1
+
+// Declared in libphonenumber's metadata.h, which isn't installed with the
+// other headers. This is the same compiled in metadata PhoneNumberUtil loads,
+// a serialized PhoneMetadataCollection.
+namespace i18n {
+namespace phonenumbers {
+int metadata_size();
+const void *metadata_get();
+} // namespace phonenumbers
+} // namespace i18n
+
+#endif /* MINI_PHONE_COMPILED_METADATA_H */
@@ -0,0 +1,342 @@
+#include "digit_pattern.h"
+#include <algorithm>
+
+// Capturing groups per format pattern, the metadata uses at most 6.
+static const size_t MAX_GROUPS = 16;
+
+// Digits a leading digits pattern can match, the metadata goes up to 7. Keeps
+// the offsets a prefix pattern reaches within a 32 bit set.
+static const int MAX_PREFIX_LENGTH = 30;
+
+// Counts in `{n,m}`, the metadata goes up to 13.
+static const int MAX_COUNT = 99;
+
+static const uint16_t ANY_DIGIT = 0x3ff;
+
+struct DigitPatternParser {
+  const std::string &pattern;
+  size_t pos = 0;
+  bool failed = false;
+
+  explicit DigitPatternParser(const std::string &pattern) : pattern(pattern) {}
+
+  int peek() const { return pos < pattern.size() ? static_cast<unsigned char>(pattern[pos]) : -1; }
+
+  bool accept(char c) {
+    if (peek() == c) {
+      pos++;
+      return true;
+    }
+
+    return false;
+  }
+
+  bool parse_number(int *value) {
+    int digits = 0;
+    *value = 0;
+
+    while (peek() >= '0' && peek() <= '9' && digits < 3) {
+      *value = *value * 10 + (pattern[pos++] - '0');
+      digits++;
+    }
+
+    return digits > 0;
+  }
+
+  // A digit, `\d` or a character class, as the set of digits it matches
+  bool parse_digits(uint16_t *digits) {
+    int c = peek();
+
+    if (c >= '0' && c <= '9') {
+      pos++;
+      *digits = 1 << (c - '0');
+      return true;
+    }
+
+    if (c == '\\') {
+      pos++;
+
+      if (!accept('d')) {
+        return false;
+      }
+
+      *digits = ANY_DIGIT;
+      return true;
+    }
+
+    if (c == '[') {
+      pos++;
+      return parse_class(digits);
+    }
+
+    return false;
+  }
+
+  bool parse_class(uint16_t *result) {
+    bool negated = accept('^');
+    uint16_t digits = 0;
+
+    while (!accept(']')) {
+      int c = peek();
+
+      if (c == '\\' && pos + 1 < pattern.size() && pattern[pos + 1] == 'd') {
+        pos += 2;
+        digits |= ANY_DIGIT;
+      } else if (c >= '0' && c <= '9') {
+        pos++;
+        int last = c;
+
+        if (accept('-')) {
+          last = peek();
+
+          if (last < c || last > '9') {
+            return false;
+          }
+
+          pos++;
+        }
+
+        for (int digit = c; digit <= last; digit++) {
+          digits |= 1 << (digit - '0');
+        }
+      } else {
+        return false;
+      }
+    }
+
+    *result = negated ? ~digits & ANY_DIGIT : digits;
+    return true;
+  }
+
+  // Leading digits patterns. Each returns the most digits the parsed node
+  // can match, the nodes go into `nodes` in prefix order.
+
+  int parse_alternate(std::vector<DigitPrefixPattern::Node> *nodes) {
+    size_t index = add(nodes, DigitPrefixPattern::ALTERNATE);
+    int length = parse_concat(nodes);
+
+    while (!failed && accept('|')) {
+      length = std::max(length, parse_concat(nodes));
+    }
+
+    return finish(nodes, index, length);
+  }
+
+  int parse_concat(std::vector<DigitPrefixPattern::Node> *nodes) {
+    size_t index = add(nodes, DigitPrefixPattern::CONCAT);
+    int length = 0;
+
+    while (!failed && peek() != -1 && peek() != '|' && peek() != ')') {
+      if (accept('(')) {
+        if (!accept('?') || !accept(':')) {
+          failed = true;
+          break;
+        }
+
+        length += parse_alternate(nodes);
+
+        if (!accept(')')) {
+          failed = true;
+        }
+      } else {
+        size_t atom = add(nodes, DigitPrefixPattern::DIGITS);
+
+        if (!parse_digits(&(*nodes)[atom].digits)) {
+          failed = true;
+        }
+
+        finish(nodes, atom, 1);
+        length++;
+      }
+    }
+
+    return finish(nodes, index, length);
+  }
+
+  size_t add(std::vector<DigitPrefixPattern::Node> *nodes, DigitPrefixPattern::Kind kind) {
+    nodes->push_back(DigitPrefixPattern::Node{kind, 0, 0});
+
+    return nodes->size() - 1;
+  }
+
+  int finish(std::vector<DigitPrefixPattern::Node> *nodes, size_t index, int length) {
+    if (nodes->size() > UINT16_MAX || length > MAX_PREFIX_LENGTH) {
+      failed = true;
+    }
+
+    (*nodes)[index].end = static_cast<uint16_t>(nodes->size());
+
+    return length;
+  }
+};
+
+bool DigitPrefixPattern::compile(const std::string &pattern) {
+  DigitPatternParser parser(pattern);
+
+  nodes.clear();
+  parser.parse_alternate(&nodes);
+
+  // An unbalanced ')' stops the parse early
+  if (parser.failed || parser.peek() != -1) {
+    nodes.clear();
+    return false;
+  }
+
+  return true;
+}
+
+// The node matched from each offset in `offsets` (bit n for offset n), giving
+// the offsets it can end at. Alternatives are followed side by side.
+uint32_t DigitPrefixPattern::run(size_t index, const std::string &digits, uint32_t offsets) const {
+  const Node &node = nodes[index];
+
+  switch (node.kind) {
+  case DIGITS: {
+    uint32_t next = 0;
+
+    for (size_t offset = 0; offset < digits.size() && (offsets >> offset) != 0; offset++) {
+      unsigned digit = static_cast<unsigned>(digits[offset] - '0');
+
+      if ((offsets >> offset & 1) && digit <= 9 && (node.digits & (1 << digit))) {
+        next |= 1u << (offset + 1);
+      }
+    }
+
+    return next;
+  }
+  case CONCAT:
+    for (size_t child = index + 1; child < node.end && offsets != 0; child = nodes[child].end) {
+      offsets = run(child, digits, offsets);
+    }
+
+    return offsets;
+  case ALTERNATE: {
+    uint32_t next = 0;
+
+    for (size_t child = index + 1; child < node.end; child = nodes[child].end) {
+      next |= run(child, digits, offsets);
+    }
+
+    return next;
+  }
+  }
+
+  return 0;
+}
+
+bool DigitPrefixPattern::match_prefix(const std::string &digits) const {
+  return !nodes.empty() && run(0, digits, 1) != 0;
+}
+
+bool DigitGroupsPattern::compile(const std::string &pattern) {
+  DigitPatternParser parser(pattern);
+
+  groups.clear();
+
+  while (parser.peek() != -1) {
+    Group group{0, 1, 1};
+
+    if (groups.size() == MAX_GROUPS || !parser.accept('(') || !parser.parse_digits(&group.digits)) {
+      groups.clear();
+      return false;
+    }
+
+    if (parser.accept('{')) {
+      if (!parser.parse_number(&group.min)) {
+        groups.clear();
+        return false;
+      }
+
+      group.max = group.min;
+
+      if (parser.accept(',') && !parser.parse_number(&group.max)) {
+        groups.clear();
+        return false;
+      }
+
+      if (!parser.accept('}') || group.max < group.min || group.max > MAX_COUNT) {
+        groups.clear();
+        return false;
+      }
+    }
+
+    if (!parser.accept(')')) {
+      groups.clear();
+      return false;
+    }
+
+    groups.push_back(group);
+  }
+
+  return !groups.empty();
+}
+
+bool DigitGroupsPattern::match_full(const std::string &digits, std::vector<int> *captures) const {
+  size_t length = digits.size();
+
+  if (groups.empty() || length > MAX_DIGITS) {
+    return false;
+  }
+
+  // reachable[i] has bit n set when groups i and on can match the digits from
+  // offset n to the end
+  uint64_t reachable[MAX_GROUPS + 1];
+  reachable[groups.size()] = uint64_t(1) << length;
+
+  for (size_t i = groups.size(); i-- > 0;) {
+    const Group &group = groups[i];
+    reachable[i] = 0;
+
+    for (size_t offset = 0; offset <= length; offset++) {
+      for (size_t count = 0; count <= static_cast<size_t>(group.max) && offset + count <= length; count++) {
+        if (count > 0) {
+          unsigned digit = static_cast<unsigned>(digits[offset + count - 1] - '0');
+
+          if (digit > 9 || !(group.digits & (1 << digit))) {
+            break;
+          }
+        }
+
+        if (count >= static_cast<size_t>(group.min) && (reachable[i + 1] >> (offset + count) & 1)) {
+          reachable[i] |= uint64_t(1) << offset;
+          break;
+        }
+      }
+    }
+  }
+
+  if (!(reachable[0] & 1)) {
+    return false;
+  }
+
+  // Each group takes as many digits as it can while the rest still match,
+  // which is where backtracking would end up too
+  captures->resize(groups.size() * 2);
+  size_t offset = 0;
+
+  for (size_t i = 0; i < groups.size(); i++) {
+    const Group &group = groups[i];
+    size_t count = 0;
+    size_t taken = 0;
+
+    while (count < static_cast<size_t>(group.max) && offset + count < length) {
+      unsigned digit = static_cast<unsigned>(digits[offset + count] - '0');
+
+      if (digit > 9 || !(group.digits & (1 << digit))) {
+        break;
+      }
+
+      count++;
+
+      if (count >= static_cast<size_t>(group.min) && (reachable[i + 1] >> (offset + count) & 1)) {
+        taken = count;
+      }
+    }
+
+    (*captures)[i * 2] = static_cast<int>(offset);
+    (*captures)[i * 2 + 1] = static_cast<int>(offset + taken);
+    offset += taken;
+  }
+
+  return offset == length;
+}
@@ -0,0 +1,74 @@
+#ifndef MINI_PHONE_DIGIT_PATTERN_H
+#define MINI_PHONE_DIGIT_PATTERN_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Matchers for the two kinds of regular expressions in libphonenumber's
+// formatting metadata, limited to exactly the syntax those use. Patterns
+// outside of it don't compile, and the caller leaves them to libphonenumber.
+// Neither matcher backtracks: the time they take is bounded by the length of
+// the pattern times the length of the digits.
+
+// A leading digits pattern, like `2[0-3]|3(?:0|1[2-5])`: digits, `\d`,
+// character classes (`[2-9]`, `[^0]`), `(?:...)` and alternation. No
+// quantifiers or capturing groups, so every alternative matches a fixed
+// number of digits.
+class DigitPrefixPattern {
+public:
+  // Returns false when the pattern uses syntax outside of the subset.
+  bool compile(const std::string &pattern);
+
+  // Whether the pattern matches the start of `digits` (like RE2::Consume).
+  bool match_prefix(const std::string &digits) const;
+
+private:
+  enum Kind : uint8_t { DIGITS, CONCAT, ALTERNATE };
+
+  // The parsed pattern, each node followed by its children
+  struct Node {
+    Kind kind;
+    // DIGITS: bit n is set when digit n matches
+    uint16_t digits;
+    // The index after the node and its children
+    uint16_t end;
+  };
+
+  std::vector<Node> nodes;
+
+  uint32_t run(size_t index, const std::string &digits, uint32_t offsets) const;
+
+  friend struct DigitPatternParser;
+};
+
+// A format pattern, like `(\d{3})(\d{3,4})(\d{4})`: a sequence of capturing
+// groups, each a digit, `\d` or a character class with an optional `{n}` or
+// `{n,m}` count.
+class DigitGroupsPattern {
+public:
+  // Longer digits never match, format those with libphonenumber.
+  static const size_t MAX_DIGITS = 63;
+
+  // Returns false when the pattern uses syntax outside of the subset.
+  bool compile(const std::string &pattern);
+
+  // Whether the pattern matches all of `digits`. On a match `captures` holds
+  // a begin/end offset pair per group. Groups are greedy in order, like they
+  // are with RE2 and ICU, so they split the digits the same way.
+  bool match_full(const std::string &digits, std::vector<int> *captures) const;
+
+  size_t group_count() const { return groups.size(); }
+
+private:
+  struct Group {
+    uint16_t digits;
+    int min;
+    int max;
+  };
+
+  std::vector<Group> groups;
+};
+
+#endif /* MINI_PHONE_DIGIT_PATTERN_H */
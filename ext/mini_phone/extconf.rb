@@ -37,6 +37,10 @@ unless have_library('phonenumber') && have_library('protobuf')
   MSG
 end
 
+have_library('pthread')
+have_header('sys/mman.h')
+have_func('rb_ext_ractor_safe', 'ruby.h')
+
 dir_config('mini_phone')
 append_cppflags('-O3')
 $CXXFLAGS << ' -std=c++17 ' unless $CXXFLAGS.include?('-std=c++')
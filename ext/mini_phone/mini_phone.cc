@@ -1,29 +1,141 @@
 #include "mini_phone.h"
+#include "ascii_digits.h"
+#include "phonenumbers/asyoutypeformatter.h"
 #include "phonenumbers/phonemetadata.pb.h"
+#include "phonenumbers/phonenumbermatch.h"
+#include "phonenumbers/phonenumbermatcher.h"
 #include "phonenumbers/phonenumber.pb.h"
 #include "phonenumbers/phonenumberutil.h"
+#include "number_format.h"
+#include "number_matcher.h"
+#include "number_set.h"
+#include "number_shape.h"
+#include "packed_number.h"
+#include "parse_cache.h"
+#include "prefix_data.h"
+#include "region_codes.h"
+#include "stats.h"
+#include "stream_normalizer.h"
+#include "ruby/encoding.h"
+#include "ruby/thread.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace ::i18n::phonenumbers;
 
-using google::protobuf::RepeatedPtrField;
-
 static VALUE rb_mMiniPhone;
 
 static VALUE rb_cPhoneNumber;
 
-static RepeatedPtrField<NumberFormat> raw_national_format;
-static RepeatedPtrField<NumberFormat> dasherized_national_format;
+static VALUE rb_cNumberSet;
+
+static VALUE rb_cMatcher;
+
+static VALUE rb_cNumberMatch;
+
+static VALUE rb_cAsYouType;
+
+// Results memoized by the PhoneNumber accessors. Each one has a slot in
+// `PhoneNumberInfo::attrs` and a bit in `PhoneNumberInfo::computed`.
+enum PhoneNumberAttr {
+  ATTR_E164,
+  ATTR_NATIONAL,
+  ATTR_INTERNATIONAL,
+  ATTR_RFC3966,
+  ATTR_RAW_NATIONAL,
+  ATTR_DASHERIZED_NATIONAL,
+  ATTR_RAW_INTERNATIONAL,
+  ATTR_DASHERIZED_INTERNATIONAL,
+  ATTR_COUNTRY_CODE,
+  ATTR_REGION_CODE,
+  ATTR_TYPE,
+  ATTR_AREA_CODE,
+  ATTR_CARRIER,
+  ATTR_LOCATION,
+  ATTR_COUNT,
+};
+
+// Boolean results don't need a slot, they are stored as a pair of bits.
+static const uint32_t FLAG_VALID_COMPUTED = 1u << ATTR_COUNT;
+static const uint32_t FLAG_VALID = 1u << (ATTR_COUNT + 1);
+static const uint32_t FLAG_POSSIBLE_COMPUTED = 1u << (ATTR_COUNT + 2);
+static const uint32_t FLAG_POSSIBLE = 1u << (ATTR_COUNT + 3);
 
 extern "C" struct PhoneNumberInfo {
-  PhoneNumber *phone_number;
+  PhoneNumber phone_number;
+  VALUE input_region_code;
+  VALUE attrs[ATTR_COUNT];
+  uint32_t computed;
 };
 
-extern "C" size_t phone_number_info_size(const void *data) { return sizeof(PhoneNumberInfo); }
+extern "C" size_t phone_number_info_size(const void *data) {
+  const PhoneNumberInfo *phone_number_info = static_cast<const PhoneNumberInfo *>(data);
+  const PhoneNumber &phone_number = phone_number_info->phone_number;
+
+  return sizeof(PhoneNumberInfo) + phone_number.raw_input().capacity() + phone_number.extension().capacity() +
+         phone_number.preferred_domestic_carrier_code().capacity();
+}
+
+extern "C" void phone_number_info_mark(void *data) {
+  PhoneNumberInfo *phone_number_info = static_cast<PhoneNumberInfo *>(data);
+
+  rb_gc_mark_movable(phone_number_info->input_region_code);
+
+  for (int i = 0; i < ATTR_COUNT; i++) {
+    rb_gc_mark_movable(phone_number_info->attrs[i]);
+  }
+}
+
+extern "C" void phone_number_info_compact(void *data) {
+  PhoneNumberInfo *phone_number_info = static_cast<PhoneNumberInfo *>(data);
+
+  phone_number_info->input_region_code = rb_gc_location(phone_number_info->input_region_code);
+
+  for (int i = 0; i < ATTR_COUNT; i++) {
+    phone_number_info->attrs[i] = rb_gc_location(phone_number_info->attrs[i]);
+  }
+}
+
+// Freed PhoneNumberInfo structs (with their embedded PhoneNumber) are kept on
+// a bounded free list and handed out again by rb_phone_number_alloc, so
+// short-lived numbers don't need to go through malloc at all. Recycled
+// messages are cleared, which keeps the capacity of their strings around.
+static std::mutex phone_number_pool_mutex;
+static std::vector<PhoneNumberInfo *> phone_number_pool;
+static size_t phone_number_pool_capacity = 1024;
+static size_t phone_number_pool_allocated = 0;
+static size_t phone_number_pool_recycled = 0;
 
 extern "C" void phone_number_info_free(void *data) {
   PhoneNumberInfo *phone_number_info = static_cast<PhoneNumberInfo *>(data);
-  phone_number_info->phone_number->~PhoneNumber();
-  xfree(phone_number_info->phone_number);
+  phone_number_info->phone_number.Clear();
+
+  {
+    std::lock_guard<std::mutex> guard(phone_number_pool_mutex);
+
+    if (phone_number_pool.size() < phone_number_pool_capacity) {
+      phone_number_pool.push_back(phone_number_info);
+      return;
+    }
+  }
+
   phone_number_info->~PhoneNumberInfo();
   xfree(data);
 }
@@ -32,340 +144,403 @@ extern "C" const rb_data_type_t phone_number_info_type = {
     .wrap_struct_name = "MiniPhone/PhoneNumberInfo",
     .function =
         {
-            .dmark = NULL,
+            .dmark = phone_number_info_mark,
             .dfree = phone_number_info_free,
             .dsize = phone_number_info_size,
+            .dcompact = phone_number_info_compact,
         },
     .parent = NULL,
     .data = NULL,
     .flags = RUBY_TYPED_FREE_IMMEDIATELY,
 };
 
-static inline VALUE is_phone_number_valid(VALUE self, VALUE str, VALUE cc) {
-  if (NIL_P(str) || NIL_P(cc)) {
-    return Qfalse;
+static inline PhoneNumberInfo *phone_number_info_get(VALUE self) {
+  PhoneNumberInfo *phone_number_info;
+  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
+
+  return phone_number_info;
+}
+
+static inline bool phone_number_attr_computed(PhoneNumberInfo *phone_number_info, PhoneNumberAttr attr) {
+  return phone_number_info->computed & (1u << attr);
+}
+
+static inline VALUE phone_number_attr_set(PhoneNumberInfo *phone_number_info, PhoneNumberAttr attr, VALUE value) {
+  phone_number_info->attrs[attr] = value;
+  phone_number_info->computed |= 1u << attr;
+
+  return value;
+}
+
+static inline VALUE phone_number_flag_set(PhoneNumberInfo *phone_number_info, uint32_t computed_flag, uint32_t flag,
+                                          bool value) {
+  phone_number_info->computed |= computed_flag;
+
+  if (value) {
+    phone_number_info->computed |= flag;
   }
 
-  PhoneNumber parsed_number;
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  return value ? Qtrue : Qfalse;
+}
 
-  std::string phone_number(RSTRING_PTR(str), RSTRING_LEN(str));
-  std::string country_code(RSTRING_PTR(cc), RSTRING_LEN(cc));
+// Frozen, deduplicated strings for every entry of the region code table
+// (indexed by RegionCode::index) and for every country calling code in use,
+// built once at load time so region lookups never allocate.
+static std::vector<VALUE> region_code_strings;
+static std::vector<VALUE> country_code_strings;
 
-  auto result = phone_util.ParseAndKeepRawInput(phone_number, country_code, &parsed_number);
+static inline void setup_region_codes() {
+  region_code_strings.resize(region_code_count());
 
-  if (result != PhoneNumberUtil::NO_PARSING_ERROR) {
-    return Qfalse;
+  for (size_t i = 0; i < region_code_count(); i++) {
+    const std::string &code = region_code_at(i)->code;
+    region_code_strings[i] = rb_interned_str(code.data(), code.size());
+    rb_gc_register_mark_object(region_code_strings[i]);
   }
 
-  if (country_code == "ZZ" && phone_util.IsValidNumber(parsed_number)) {
-    return Qtrue;
-  } else if (phone_util.IsValidNumberForRegion(parsed_number, country_code)) {
-    return Qtrue;
-  } else {
-    return Qfalse;
+  country_code_strings.resize(MAX_COUNTRY_CODE + 1, Qnil);
+
+  for (int country_code = 1; country_code <= MAX_COUNTRY_CODE; country_code++) {
+    if (region_code_for_country_code(country_code) != region_code_unknown()) {
+      std::string digits = std::to_string(country_code);
+      country_code_strings[country_code] = rb_interned_str(digits.data(), digits.size());
+      rb_gc_register_mark_object(country_code_strings[country_code]);
+    }
   }
 }
 
-extern "C" VALUE rb_is_phone_number_valid(VALUE self, VALUE str) {
-  VALUE input_region_code = rb_iv_get(rb_mMiniPhone, "@default_country");
+static inline VALUE region_code_string(const RegionCode *region) { return region_code_strings[region->index]; }
 
-  return is_phone_number_valid(self, str, input_region_code);
+static inline VALUE country_code_string(int country_code) {
+  if (country_code > 0 && country_code <= MAX_COUNTRY_CODE && !NIL_P(country_code_strings[country_code])) {
+    return country_code_strings[country_code];
+  }
+
+  return rb_fix2str(INT2FIX(country_code), 10);
 }
 
-extern "C" VALUE rb_normalize_digits_only(VALUE self, VALUE str) {
-  if (NIL_P(str)) {
-    return Qnil;
+// Region codes can be given as Strings or Symbols. Known region codes are
+// swapped for the shared frozen string, so they can be stored and returned
+// without copying (and can't be mutated behind our back).
+static inline VALUE region_code_value(VALUE code) {
+  if (NIL_P(code)) {
+    return code;
   }
 
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
-
-  std::string phone_number(RSTRING_PTR(str), RSTRING_LEN(str));
+  if (SYMBOL_P(code)) {
+    code = rb_sym2str(code);
+  } else {
+    Check_Type(code, T_STRING);
+  }
 
-  phone_util.NormalizeDigitsOnly(&phone_number);
+  const RegionCode *region = region_code_lookup(RSTRING_PTR(code), RSTRING_LEN(code));
 
-  return rb_str_new(phone_number.c_str(), phone_number.size());
+  return region == NULL ? code : region_code_string(region);
 }
 
-extern "C" VALUE rb_is_phone_number_valid_for_country(VALUE self, VALUE str, VALUE cc) {
-  return is_phone_number_valid(self, str, cc);
+// The default region lives in native storage rather than in an ivar on the
+// module, so it can be read from any thread or Ractor without touching shared
+// Ruby state. It always holds a frozen, interned string, which is shareable.
+// `with_default_country` overrides it with a fiber local, and only when a
+// scope is active do we pay for looking that up.
+static std::atomic<VALUE> default_country_code;
+static std::atomic<size_t> default_country_scopes{0};
+static ID id_default_country;
+
+// Interned strings can be collected, so whatever default_country_code holds is
+// marked through this one object, registered once at load time. It isn't
+// write barrier protected, which makes the GC mark it on minor GCs too, so a
+// new default is kept alive without the object ever being written to.
+extern "C" void default_country_holder_mark(void *data) {
+  rb_gc_mark(static_cast<std::atomic<VALUE> *>(data)->load(std::memory_order_relaxed));
 }
 
-extern "C" VALUE rb_is_phone_number_invalid(VALUE self, VALUE str) {
-  return rb_is_phone_number_valid(self, str) == Qtrue ? Qfalse : Qtrue;
-}
+extern "C" const rb_data_type_t default_country_holder_type = {
+    .wrap_struct_name = "MiniPhone/DefaultCountry",
+    .function =
+        {
+            .dmark = default_country_holder_mark,
+            .dfree = NULL,
+            .dsize = NULL,
+            .dcompact = NULL,
+        },
+    .parent = NULL,
+    .data = NULL,
+    .flags = 0,
+};
 
-extern "C" VALUE rb_is_phone_number_invalid_for_country(VALUE self, VALUE str, VALUE cc) {
-  return is_phone_number_valid(self, str, cc) == Qtrue ? Qfalse : Qtrue;
-}
+static inline VALUE default_country_string(VALUE code) {
+  code = region_code_value(NIL_P(code) ? region_code_string(region_code_unknown()) : code);
 
-extern "C" VALUE rb_is_phone_number_possible(VALUE self, VALUE str) {
-  if (NIL_P(str)) {
-    return Qnil;
+  if (!RB_OBJ_FROZEN(code)) {
+    code = rb_interned_str(RSTRING_PTR(code), RSTRING_LEN(code));
   }
 
-  PhoneNumber parsed_number;
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
-
-  VALUE input_region_code = rb_iv_get(rb_mMiniPhone, "@default_country");
-  std::string phone_number(RSTRING_PTR(str), RSTRING_LEN(str));
-  std::string country_code(RSTRING_PTR(input_region_code), RSTRING_LEN(input_region_code));
+  return code;
+}
 
-  auto result = phone_util.Parse(phone_number, country_code, &parsed_number);
+static inline VALUE default_country() {
+  if (default_country_scopes.load(std::memory_order_relaxed) > 0) {
+    VALUE code = rb_thread_local_aref(rb_thread_current(), id_default_country);
 
-  if (result == PhoneNumberUtil::NO_PARSING_ERROR && phone_util.IsPossibleNumber(parsed_number)) {
-    return Qtrue;
-  } else {
-    return Qfalse;
+    if (!NIL_P(code)) {
+      return code;
+    }
   }
-}
 
-extern "C" VALUE rb_is_phone_number_impossible(VALUE self, VALUE str) {
-  return rb_is_phone_number_possible(self, str) == Qtrue ? Qfalse : Qtrue;
+  return default_country_code.load(std::memory_order_relaxed);
 }
 
-extern "C" VALUE rb_set_default_country(VALUE self, VALUE str_code) {
-  if (NIL_P(str_code)) {
-    str_code = rb_str_new("ZZ", 2);
-  }
+// libphonenumber only takes `const std::string &`, so the Ruby strings have to
+// be copied. Copying into a thread local scratch buffer means this does not
+// allocate once the buffer has grown, and known region codes are not copied
+// at all since they are interned in the region code table.
+static inline std::string *phone_number_scratch(VALUE str) {
+  StatsTimer timer(STATS_PHASE_INPUT);
+  static thread_local std::string scratch;
+  scratch.assign(RSTRING_PTR(str), RSTRING_LEN(str));
 
-  return rb_iv_set(self, "@default_country", str_code);
+  return &scratch;
 }
 
-extern "C" VALUE rb_get_default_country(VALUE self) { return rb_iv_get(self, "@default_country"); }
+static inline const std::string &region_code_scratch(VALUE str) {
+  StatsTimer timer(STATS_PHASE_INPUT);
+  const RegionCode *region = region_code_lookup(RSTRING_PTR(str), RSTRING_LEN(str));
 
-extern "C" VALUE rb_phone_number_parse(int argc, VALUE *argv, VALUE self) {
-  return rb_class_new_instance(argc, argv, rb_cPhoneNumber);
-}
+  if (region != NULL) {
+    return region->code;
+  }
 
-extern "C" VALUE rb_phone_number_alloc(VALUE self) {
-  void *phone_number_data = ALLOC(PhoneNumber);
-  void *data = ALLOC(PhoneNumberInfo);
-  PhoneNumberInfo *phone_number_info = new (data) PhoneNumberInfo();
-  PhoneNumber *phone_number = new (phone_number_data) PhoneNumber();
-  phone_number_info->phone_number = phone_number;
+  static thread_local std::string scratch;
+  scratch.assign(RSTRING_PTR(str), RSTRING_LEN(str));
 
-  return TypedData_Wrap_Struct(self, &phone_number_info_type, phone_number_info);
+  return scratch;
 }
 
-static inline VALUE rb_phone_number_nullify_ivars(VALUE self) {
-  rb_iv_set(self, "@national", Qnil);
-  rb_iv_set(self, "@raw_national", Qnil);
-  rb_iv_set(self, "@dasherized_national", Qnil);
-  rb_iv_set(self, "@international", Qnil);
-  rb_iv_set(self, "@raw_international", Qnil);
-  rb_iv_set(self, "@dasherized_international", Qnil);
-  rb_iv_set(self, "@e164", Qnil);
-  rb_iv_set(self, "@country_code", Qnil);
-  rb_iv_set(self, "@region_code", Qnil);
-  rb_iv_set(self, "@rfc3966", Qnil);
-  rb_iv_set(self, "@type", Qnil);
-  rb_iv_set(self, "@valid", Qfalse);
-  rb_iv_set(self, "@possible", Qfalse);
-  rb_iv_set(self, "@area_code", Qnil);
+// libphonenumber's parsers and GetNumberType, timed for MiniPhone.stats
+static inline PhoneNumberUtil::ErrorType parse_keeping_raw_input(const PhoneNumberUtil &phone_util,
+                                                                 const std::string &number,
+                                                                 const std::string &region_code,
+                                                                 PhoneNumber *parsed_number) {
+  StatsTimer timer(STATS_PHASE_PARSE, &region_code);
 
-  return Qtrue;
+  return phone_util.ParseAndKeepRawInput(number, region_code, parsed_number);
 }
 
-static inline VALUE rb_phone_number_format(VALUE self, PhoneNumberUtil::PhoneNumberFormat fmt) {
-  std::string formatted_number;
-  PhoneNumberInfo *phone_number_info;
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
-
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
-  PhoneNumber *parsed_number = phone_number_info->phone_number;
-  phone_util.Format(*parsed_number, fmt, &formatted_number);
+static inline PhoneNumberUtil::ErrorType parse_number(const PhoneNumberUtil &phone_util, const std::string &number,
+                                                      const std::string &region_code, PhoneNumber *parsed_number) {
+  StatsTimer timer(STATS_PHASE_PARSE, &region_code);
 
-  return rb_str_new(formatted_number.c_str(), formatted_number.size());
+  return phone_util.Parse(number, region_code, parsed_number);
 }
 
-extern "C" VALUE rb_phone_number_e164(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@e164"))) {
-    return rb_iv_get(self, "@e164");
-  }
+static inline PhoneNumberUtil::PhoneNumberType number_type(const PhoneNumberUtil &phone_util,
+                                                           const PhoneNumber &parsed_number) {
+  StatsTimer timer(STATS_PHASE_TYPE);
 
-  return rb_iv_set(self, "@e164", rb_phone_number_format(self, PhoneNumberUtil::PhoneNumberFormat::E164));
+  return phone_util.GetNumberType(parsed_number);
 }
 
-extern "C" VALUE rb_phone_number_national(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@national"))) {
-    return rb_iv_get(self, "@national");
+static inline bool is_number_valid_for_region(const PhoneNumberUtil &phone_util, const PhoneNumber &parsed_number,
+                                              const std::string &country_code) {
+  // With MiniPhone.restrict_regions, numbers from other regions are rejected
+  // before libphonenumber runs any of its regexes
+  const RegionRestriction *restriction = region_codes_restriction();
+  RegionCheck check = region_code_check_country_code(restriction, parsed_number.country_code());
+
+  if (check == REGION_CHECK_REJECTED) {
+    return false;
   }
 
-  return rb_iv_set(self, "@national", rb_phone_number_format(self, PhoneNumberUtil::PhoneNumberFormat::NATIONAL));
-}
+  StatsTimer timer(STATS_PHASE_VALIDATE, &country_code);
+  bool valid;
 
-extern "C" VALUE rb_phone_number_international(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@international"))) {
-    return rb_iv_get(self, "@international");
+  if (country_code == "ZZ" && phone_util.IsValidNumber(parsed_number)) {
+    valid = true;
+  } else if (phone_util.IsValidNumberForRegion(parsed_number, country_code)) {
+    valid = true;
+  } else {
+    valid = false;
   }
 
-  return rb_iv_set(self, "@international",
-                   rb_phone_number_format(self, PhoneNumberUtil::PhoneNumberFormat::INTERNATIONAL));
-}
-
-extern "C" VALUE rb_phone_number_rfc3966(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@rfc3966"))) {
-    return rb_iv_get(self, "@rfc3966");
+  if (valid && check == REGION_CHECK_BY_REGION) {
+    std::string region_code;
+    phone_util.GetRegionCodeForNumber(parsed_number, &region_code);
+    valid = region_code_allowed(restriction, region_code_lookup(region_code.data(), region_code.size()));
   }
 
-  return rb_iv_set(self, "@rfc3966", rb_phone_number_format(self, PhoneNumberUtil::PhoneNumberFormat::RFC3966));
+  return valid;
 }
 
-VALUE format_by_pattern_national(VALUE self, RepeatedPtrField<NumberFormat> format) {
-  std::string formatted_number;
-  PhoneNumberInfo *phone_number_info;
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
+// Parses and validates `phone_number`. When it's valid and `valid_number` is
+// given, the parsed number is copied there too (for the one-shot functions).
+static inline bool is_parsed_number_valid(const PhoneNumberUtil &phone_util, const std::string &phone_number,
+                                          const std::string &country_code, PhoneNumber *valid_number = nullptr) {
+  bool region_valid = region_code_valid_for_parsing(country_code.data(), country_code.size());
+  uint64_t national_number;
+  NumberShape shape = number_shape(phone_number.data(), phone_number.size(), region_valid, &national_number);
 
-  phone_util.FormatByPattern(*phone_number_info->phone_number, PhoneNumberUtil::NATIONAL, format, &formatted_number);
+  if (shape == NUMBER_SHAPE_JUNK) {
+    return false;
+  }
 
-  return rb_str_new(formatted_number.c_str(), formatted_number.size());
-}
+  if (parse_cache_enabled()) {
+    auto entry = parse_cache_fetch(phone_number, country_code);
+    int8_t valid = entry->valid.load(std::memory_order_relaxed);
 
-extern "C" VALUE rb_phone_number_raw_national(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@raw_national"))) {
-    return rb_iv_get(self, "@raw_national");
+    if (valid < 0) {
+      valid = entry->parsed_ok && is_number_valid_for_region(phone_util, entry->number, country_code);
+      entry->valid.store(valid, std::memory_order_relaxed);
+    }
+
+    if (valid && valid_number) {
+      *valid_number = entry->number;
+    }
+
+    return valid;
   }
 
-  VALUE result = format_by_pattern_national(self, raw_national_format);
+  PhoneNumber local_number;
+  PhoneNumber *parsed_number = valid_number ? valid_number : &local_number;
 
-  return rb_iv_set(self, "@raw_national", result);
-}
+  if (shape == NUMBER_SHAPE_NANP_E164) {
+    // Exactly what ParseAndKeepRawInput would have produced, minus the parsing
+    parsed_number->Clear();
+    parsed_number->set_country_code(1);
+    parsed_number->set_national_number(national_number);
+    parsed_number->set_raw_input(phone_number);
+    parsed_number->set_country_code_source(PhoneNumber::FROM_NUMBER_WITH_PLUS_SIGN);
 
-extern "C" VALUE rb_phone_number_dasherized_national(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@dasherized_national"))) {
-    return rb_iv_get(self, "@dasherized_national");
+    return is_number_valid_for_region(phone_util, *parsed_number, country_code);
   }
 
-  VALUE result = format_by_pattern_national(self, dasherized_national_format);
+  auto result = parse_keeping_raw_input(phone_util, phone_number, country_code, parsed_number);
+
+  if (result != PhoneNumberUtil::NO_PARSING_ERROR) {
+    return false;
+  }
 
-  return rb_iv_set(self, "@dasherized_national", result);
+  return is_number_valid_for_region(phone_util, *parsed_number, country_code);
 }
 
-extern "C" VALUE rb_phone_number_country_code(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@country_code"))) {
-    return rb_iv_get(self, "@country_code");
+static inline VALUE is_phone_number_valid(VALUE self, VALUE str, VALUE cc) {
+  if (NIL_P(str) || NIL_P(cc)) {
+    return Qfalse;
   }
 
-  PhoneNumberInfo *phone_number_info;
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
+  cc = region_code_value(cc);
 
-  int code = phone_number_info->phone_number->country_code();
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
 
-  VALUE result = INT2NUM(code);
+  const std::string &phone_number = *phone_number_scratch(str);
+  const std::string &country_code = region_code_scratch(cc);
 
-  return rb_iv_set(self, "@country_code", result);
+  return is_parsed_number_valid(phone_util, phone_number, country_code) ? Qtrue : Qfalse;
 }
 
-extern "C" VALUE rb_phone_number_dasherized_international(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@dasherized_international"))) {
-    return rb_iv_get(self, "@dasherized_international");
-  }
-
-  VALUE national = rb_phone_number_dasherized_national(self);
-  VALUE cc = rb_fix2str(rb_phone_number_country_code(self), 10);
-  VALUE dash = rb_str_new("-", 1);
-  VALUE prefix = rb_str_concat(cc, dash);
-  VALUE result = rb_str_concat(prefix, national);
+extern "C" VALUE rb_is_phone_number_valid(VALUE self, VALUE str) {
+  VALUE input_region_code = default_country();
 
-  return rb_iv_set(self, "@dasherized_international", result);
+  return is_phone_number_valid(self, str, input_region_code);
 }
 
-extern "C" VALUE rb_phone_number_raw_international(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@raw_international"))) {
-    return rb_iv_get(self, "@raw_international");
-  }
+// NormalizeDigitsOnly, skipping libphonenumber's UTF-8 decoding for ASCII input
+static inline void normalize_digits(const PhoneNumberUtil &phone_util, const std::string &number, std::string *out) {
+  out->resize(number.size());
 
-  VALUE national = rb_phone_number_raw_national(self);
-  VALUE cc = rb_fix2str(rb_phone_number_country_code(self), 10);
-  VALUE result = rb_str_concat(cc, national);
+  size_t len = ascii_digits_copy(number.data(), number.size(), &(*out)[0]);
 
-  return rb_iv_set(self, "@raw_international", result);
+  if (len == ASCII_DIGITS_NOT_ASCII) {
+    out->assign(number);
+    phone_util.NormalizeDigitsOnly(out);
+  } else {
+    out->resize(len);
+  }
 }
 
-extern "C" VALUE rb_phone_number_possible_eh(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@possible"))) {
-    return rb_iv_get(self, "@possible");
-  }
+// Writes the digits of `str` into `buffer`, replacing its contents. ASCII input
+// goes straight from one Ruby string to the other without a copy in between.
+static VALUE normalize_digits_into(VALUE str, VALUE buffer) {
+  long len = RSTRING_LEN(str);
 
-  std::string formatted_number;
-  PhoneNumberInfo *phone_number_info;
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
+  rb_str_modify(buffer);
+  rb_str_resize(buffer, len);
 
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  size_t digits = ascii_digits_copy(RSTRING_PTR(str), len, RSTRING_PTR(buffer));
+
+  if (digits == ASCII_DIGITS_NOT_ASCII) {
+    const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+    std::string *phone_number = phone_number_scratch(str);
 
-  if (phone_util.IsPossibleNumber(*phone_number_info->phone_number)) {
-    return rb_iv_set(self, "@possible", Qtrue);
+    phone_util.NormalizeDigitsOnly(phone_number);
+    rb_str_resize(buffer, phone_number->size());
+    memcpy(RSTRING_PTR(buffer), phone_number->data(), phone_number->size());
   } else {
-    return rb_iv_set(self, "@possible", Qfalse);
+    rb_str_set_len(buffer, digits);
   }
-}
 
-extern "C" VALUE rb_phone_number_impossible_eh(VALUE self) {
-  return rb_phone_number_possible_eh(self) == Qtrue ? Qfalse : Qtrue;
+  RB_GC_GUARD(str);
+
+  return buffer;
 }
 
-extern "C" VALUE rb_phone_number_region_code(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@region_code"))) {
-    return rb_iv_get(self, "@region_code");
-  }
-  VALUE input_region_code = rb_iv_get(self, "@input_region_code");
+extern "C" VALUE rb_normalize_digits_only(int argc, VALUE *argv, VALUE self) {
+  VALUE str;
+  VALUE buffer;
 
-  if (NIL_P(input_region_code)) {
-    PhoneNumberInfo *phone_number_info;
-    std::string code;
-    TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
-    const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  rb_scan_args(argc, argv, "11", &str, &buffer);
 
-    phone_util.GetRegionCodeForCountryCode(phone_number_info->phone_number->country_code(), &code);
+  if (NIL_P(str)) {
+    return Qnil;
+  }
 
-    VALUE result = rb_str_new(code.c_str(), code.size());
+  StringValue(str);
 
-    return rb_iv_set(self, "@region_code", result);
+  if (NIL_P(buffer)) {
+    buffer = rb_str_buf_new(RSTRING_LEN(str));
   } else {
-    return rb_iv_set(self, "@region_code", input_region_code);
-  }
-}
+    StringValue(buffer);
 
-extern "C" VALUE rb_phone_number_match_eh(VALUE self, VALUE other) {
-  if (!rb_obj_is_kind_of(other, rb_cPhoneNumber)) {
-    return Qfalse;
-  }
+    // The digits are written as ASCII bytes, which would be garbage in, say,
+    // a UTF-16 buffer; the caller's buffer keeps its encoding
+    if (!rb_enc_asciicompat(rb_enc_get(buffer))) {
+      rb_raise(rb_eEncCompatError, "buffer must have an ASCII compatible encoding, not %s",
+               rb_enc_name(rb_enc_get(buffer)));
+    }
 
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+    // Non-ASCII input is only noticed part way through, so normalizing a
+    // string into itself needs the original for the fallback
+    if (buffer == str) {
+      str = rb_str_dup(str);
+    }
+  }
 
-  PhoneNumberInfo *self_info;
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, self_info);
+  return normalize_digits_into(str, buffer);
+}
 
-  PhoneNumberInfo *other_info;
-  TypedData_Get_Struct(other, PhoneNumberInfo, &phone_number_info_type, other_info);
+static inline NumberFormatStyle number_format_style_value(VALUE format) {
+  NumberFormatStyle style;
 
-  if (self_info->phone_number->raw_input() == other_info->phone_number->raw_input()) {
-    return Qtrue;
+  if (NIL_P(format)) {
+    return NUMBER_FORMAT_E164;
   }
 
-  if (phone_util.IsNumberMatch(*other_info->phone_number, *self_info->phone_number) == PhoneNumberUtil::EXACT_MATCH) {
-    return Qtrue;
-  } else {
-    return Qfalse;
-  }
-}
+  VALUE name = SYMBOL_P(format) ? rb_sym2str(format) : format;
+  Check_Type(name, T_STRING);
 
-extern "C" VALUE rb_phone_number_type(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@type"))) {
-    return rb_iv_get(self, "@type");
+  if (!number_format_style_lookup(RSTRING_PTR(name), RSTRING_LEN(name), &style)) {
+    rb_raise(rb_eArgError, "unknown format: %" PRIsVALUE, format);
   }
 
-  PhoneNumberInfo *phone_number_info;
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  return style;
+}
 
-  VALUE result;
+static inline VALUE phone_number_type_symbol(PhoneNumberUtil::PhoneNumberType type) {
+  ID result;
 
   // @see
   // https://github.com/google/libphonenumber/blob/4e9954edea7cf263532c5dd3861a801104c3f012/cpp/src/phonenumbers/phonenumberutil.h#L91
-  switch (phone_util.GetNumberType(*phone_number_info->phone_number)) {
+  switch (type) {
   case PhoneNumberUtil::PREMIUM_RATE:
     result = rb_intern("premium_rate");
     break;
@@ -404,146 +579,2739 @@ extern "C" VALUE rb_phone_number_type(VALUE self) {
     break;
   }
 
-  return rb_iv_set(self, "@type", ID2SYM(result));
+  return ID2SYM(result);
 }
 
-extern "C" VALUE rb_phone_number_area_code(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@area_code"))) {
-    return rb_iv_get(self, "@area_code");
-  }
+// One-shot functions
+//
+// For call sites which only want a single result out of a number: the input
+// is parsed, validated and formatted on the stack, and the only Ruby object
+// created is the returned String. Invalid numbers return nil.
 
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
-  PhoneNumberInfo *phone_number_info;
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
+static inline bool one_shot_parse(int argc, VALUE *argv, VALUE *opts, PhoneNumber *parsed_number) {
+  VALUE str;
+  VALUE input_region_code;
 
-  PhoneNumber *number = phone_number_info->phone_number;
-  std::string national_significant_number;
-  phone_util.GetNationalSignificantNumber(*number, &national_significant_number);
-  std::string area_code;
-  std::string subscriber_number;
+  if (opts) {
+    rb_scan_args(argc, argv, "11:", &str, &input_region_code, opts);
+  } else {
+    rb_scan_args(argc, argv, "11", &str, &input_region_code);
+  }
 
-  int area_code_length = phone_util.GetLengthOfGeographicalAreaCode(*number);
-  if (area_code_length > 0) {
-    area_code = national_significant_number.substr(0, area_code_length);
-    subscriber_number = national_significant_number.substr(area_code_length, std::string::npos);
+  if (NIL_P(input_region_code)) {
+    input_region_code = default_country();
   } else {
-    area_code = "";
-    subscriber_number = national_significant_number;
+    input_region_code = region_code_value(input_region_code);
   }
 
-  VALUE result = rb_str_new(area_code.c_str(), area_code.size());
+  if (FIXNUM_P(str)) {
+    str = rb_fix2str(str, 10);
+  } else if (!RB_TYPE_P(str, T_STRING)) {
+    return false;
+  }
 
-  return rb_iv_set(self, "@area_code", result);
-}
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
 
-extern "C" VALUE rb_phone_number_to_s(VALUE self) {
-  PhoneNumberInfo *phone_number_info;
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
-  PhoneNumber *phone_number = phone_number_info->phone_number;
+  return is_parsed_number_valid(phone_util, *phone_number_scratch(str), region_code_scratch(input_region_code),
+                                parsed_number);
+}
 
-  if (phone_number == NULL) {
-    return Qnil;
-  }
+static inline VALUE one_shot_format(const PhoneNumber &parsed_number, NumberFormatStyle style) {
+  static thread_local std::string formatted_number;
 
-  std::string raw_input = phone_number->raw_input();
+  number_format(parsed_number, style, &formatted_number);
 
-  return rb_str_new(raw_input.c_str(), raw_input.size());
+  return rb_str_new(formatted_number.data(), formatted_number.size());
 }
 
-static inline void setup_formats() {
-  // Raw
-  NumberFormat *raw_fmt = raw_national_format.Add();
-  raw_fmt->set_pattern("(\\d{3})(\\d{3})(\\d{4})");
-  raw_fmt->set_format("$1$2$3");
+extern "C" VALUE rb_one_shot_e164(int argc, VALUE *argv, VALUE self) {
+  PhoneNumber parsed_number;
+
+  if (!one_shot_parse(argc, argv, NULL, &parsed_number)) {
+    return Qnil;
+  }
 
-  // Dasherized
-  NumberFormat *dsh_fmt = dasherized_national_format.Add();
-  dsh_fmt->set_pattern("(\\d{3})(\\d{3})(\\d{4})");
-  dsh_fmt->set_format("$1-$2-$3");
+  return one_shot_format(parsed_number, NUMBER_FORMAT_E164);
 }
 
-extern "C" VALUE rb_phone_number_valid_eh(VALUE self) {
-  if (rb_ivar_defined(self, rb_intern("@valid"))) {
-    return rb_iv_get(self, "@valid");
-  }
+static ID normalize_kwarg_ids[1];
 
-  std::string formatted_number;
-  PhoneNumberInfo *phone_number_info;
-  VALUE input_region_code = rb_iv_get(self, "@input_region_code");
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
+extern "C" VALUE rb_one_shot_normalize(int argc, VALUE *argv, VALUE self) {
+  VALUE opts = Qnil;
+  VALUE kwargs[1];
+  PhoneNumber parsed_number;
 
-  if (NIL_P(input_region_code)) {
-    input_region_code = rb_iv_get(rb_mMiniPhone, "@default_country");
-  }
+  bool valid = one_shot_parse(argc, argv, &opts, &parsed_number);
 
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  rb_get_kwargs(opts, normalize_kwarg_ids, 0, 1, kwargs);
 
-  if (!rb_str_equal(input_region_code, rb_str_new_literal("ZZ"))) {
-    std::string country_code(RSTRING_PTR(input_region_code), RSTRING_LEN(input_region_code));
+  // Checked even for invalid numbers, so a typo'd format doesn't go unnoticed
+  NumberFormatStyle style = number_format_style_value(kwargs[0] == Qundef ? Qnil : kwargs[0]);
 
-    if (phone_util.IsValidNumberForRegion(*phone_number_info->phone_number, country_code)) {
-      return rb_iv_set(self, "@valid", Qtrue);
-    } else {
-      return rb_iv_set(self, "@valid", Qfalse);
-    }
+  if (!valid) {
+    return Qnil;
   }
 
-  if (phone_util.IsValidNumber(*phone_number_info->phone_number)) {
-    return rb_iv_set(self, "@valid", Qtrue);
-  } else {
-    return rb_iv_set(self, "@valid", Qfalse);
-  }
+  return one_shot_format(parsed_number, style);
 }
 
-extern "C" VALUE rb_phone_number_invalid_eh(VALUE self) {
-  return rb_phone_number_valid_eh(self) == Qtrue ? Qfalse : Qtrue;
-}
+extern "C" VALUE rb_one_shot_type(int argc, VALUE *argv, VALUE self) {
+  PhoneNumber parsed_number;
 
-extern "C" VALUE rb_phone_number_initialize(int argc, VALUE *argv, VALUE self) {
-  VALUE str;
-  VALUE input_region_code;
+  if (!one_shot_parse(argc, argv, NULL, &parsed_number)) {
+    return Qnil;
+  }
 
-  rb_scan_args(argc, argv, "11", &str, &input_region_code);
-  rb_iv_set(self, "@input_region_code", input_region_code);
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
 
-  if (NIL_P(input_region_code)) {
-    input_region_code = rb_iv_get(rb_mMiniPhone, "@default_country");
-  }
+  return phone_number_type_symbol(number_type(phone_util, parsed_number));
+}
+
+extern "C" VALUE rb_is_phone_number_valid_for_country(VALUE self, VALUE str, VALUE cc) {
+  return is_phone_number_valid(self, str, cc);
+}
+
+extern "C" VALUE rb_is_phone_number_invalid(VALUE self, VALUE str) {
+  return rb_is_phone_number_valid(self, str) == Qtrue ? Qfalse : Qtrue;
+}
+
+extern "C" VALUE rb_is_phone_number_invalid_for_country(VALUE self, VALUE str, VALUE cc) {
+  return is_phone_number_valid(self, str, cc) == Qtrue ? Qfalse : Qtrue;
+}
+
+extern "C" VALUE rb_is_phone_number_possible(VALUE self, VALUE str) {
+  if (NIL_P(str)) {
+    return Qnil;
+  }
+
+  PhoneNumber parsed_number;
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+
+  VALUE input_region_code = default_country();
+  const std::string &phone_number = *phone_number_scratch(str);
+  const std::string &country_code = region_code_scratch(input_region_code);
+
+  auto result = parse_number(phone_util, phone_number, country_code, &parsed_number);
+
+  if (result == PhoneNumberUtil::NO_PARSING_ERROR && phone_util.IsPossibleNumber(parsed_number)) {
+    return Qtrue;
+  } else {
+    return Qfalse;
+  }
+}
+
+extern "C" VALUE rb_is_phone_number_impossible(VALUE self, VALUE str) {
+  return rb_is_phone_number_possible(self, str) == Qtrue ? Qfalse : Qtrue;
+}
+
+extern "C" VALUE rb_set_default_country(VALUE self, VALUE str_code) {
+  VALUE code = default_country_string(str_code);
+
+  default_country_code.store(code, std::memory_order_relaxed);
+
+  return code;
+}
+
+extern "C" VALUE rb_get_default_country(VALUE self) { return default_country(); }
+
+struct DefaultCountryScope {
+  VALUE thread;
+  VALUE previous;
+};
+
+static VALUE default_country_scope_end(VALUE data) {
+  DefaultCountryScope *scope = reinterpret_cast<DefaultCountryScope *>(data);
+
+  rb_thread_local_aset(scope->thread, id_default_country, scope->previous);
+  default_country_scopes.fetch_sub(1, std::memory_order_relaxed);
+
+  return Qnil;
+}
+
+extern "C" VALUE rb_with_default_country(VALUE self, VALUE str_code) {
+  rb_need_block();
+
+  VALUE code = default_country_string(str_code);
+  DefaultCountryScope scope;
+
+  scope.thread = rb_thread_current();
+  scope.previous = rb_thread_local_aref(scope.thread, id_default_country);
+
+  rb_thread_local_aset(scope.thread, id_default_country, code);
+  default_country_scopes.fetch_add(1, std::memory_order_relaxed);
+
+  return rb_ensure(rb_yield, code, default_country_scope_end, reinterpret_cast<VALUE>(&scope));
+}
+
+extern "C" VALUE rb_phone_number_parse(int argc, VALUE *argv, VALUE self) {
+  return rb_class_new_instance(argc, argv, rb_cPhoneNumber);
+}
+
+extern "C" VALUE rb_phone_number_alloc(VALUE self) {
+  PhoneNumberInfo *phone_number_info = NULL;
+
+  {
+    std::lock_guard<std::mutex> guard(phone_number_pool_mutex);
+
+    if (!phone_number_pool.empty()) {
+      phone_number_info = phone_number_pool.back();
+      phone_number_pool.pop_back();
+      phone_number_pool_recycled++;
+    } else {
+      phone_number_pool_allocated++;
+    }
+  }
+
+  if (phone_number_info == NULL) {
+    void *data = ALLOC(PhoneNumberInfo);
+    phone_number_info = new (data) PhoneNumberInfo();
+  }
+
+  phone_number_info->input_region_code = Qnil;
+
+  for (int i = 0; i < ATTR_COUNT; i++) {
+    phone_number_info->attrs[i] = Qnil;
+  }
+
+  phone_number_info->computed = 0;
+
+  return TypedData_Wrap_Struct(self, &phone_number_info_type, phone_number_info);
+}
+
+// Marks every attribute as computed, so the accessors of a number which could
+// not be parsed return nil (or false) without calling into libphonenumber.
+static inline VALUE rb_phone_number_nullify(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  for (int i = 0; i < ATTR_COUNT; i++) {
+    phone_number_info->attrs[i] = Qnil;
+  }
+
+  phone_number_info->computed = ((1u << ATTR_COUNT) - 1) | FLAG_VALID_COMPUTED | FLAG_POSSIBLE_COMPUTED;
+
+  return Qtrue;
+}
+
+// Numbers which failed to parse are nullified, which memoizes a nil E.164
+static inline bool phone_number_info_parsed(PhoneNumberInfo *phone_number_info) {
+  return !phone_number_attr_computed(phone_number_info, ATTR_E164) || !NIL_P(phone_number_info->attrs[ATTR_E164]);
+}
+
+static inline VALUE rb_phone_number_format(VALUE self, NumberFormatStyle style) {
+  static thread_local std::string formatted_number;
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  number_format(phone_number_info->phone_number, style, &formatted_number);
+
+  return rb_str_new(formatted_number.c_str(), formatted_number.size());
+}
+
+extern "C" VALUE rb_phone_number_e164(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_E164)) {
+    return phone_number_info->attrs[ATTR_E164];
+  }
+
+  return phone_number_attr_set(phone_number_info, ATTR_E164,
+                               rb_phone_number_format(self, NUMBER_FORMAT_E164));
+}
+
+extern "C" VALUE rb_phone_number_national(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_NATIONAL)) {
+    return phone_number_info->attrs[ATTR_NATIONAL];
+  }
+
+  return phone_number_attr_set(phone_number_info, ATTR_NATIONAL,
+                               rb_phone_number_format(self, NUMBER_FORMAT_NATIONAL));
+}
+
+extern "C" VALUE rb_phone_number_international(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_INTERNATIONAL)) {
+    return phone_number_info->attrs[ATTR_INTERNATIONAL];
+  }
+
+  return phone_number_attr_set(phone_number_info, ATTR_INTERNATIONAL,
+                               rb_phone_number_format(self, NUMBER_FORMAT_INTERNATIONAL));
+}
+
+extern "C" VALUE rb_phone_number_rfc3966(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_RFC3966)) {
+    return phone_number_info->attrs[ATTR_RFC3966];
+  }
+
+  return phone_number_attr_set(phone_number_info, ATTR_RFC3966,
+                               rb_phone_number_format(self, NUMBER_FORMAT_RFC3966));
+}
+
+extern "C" VALUE rb_phone_number_raw_national(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_RAW_NATIONAL)) {
+    return phone_number_info->attrs[ATTR_RAW_NATIONAL];
+  }
+
+  VALUE result = rb_phone_number_format(self, NUMBER_FORMAT_RAW_NATIONAL);
+
+  return phone_number_attr_set(phone_number_info, ATTR_RAW_NATIONAL, result);
+}
+
+extern "C" VALUE rb_phone_number_dasherized_national(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_DASHERIZED_NATIONAL)) {
+    return phone_number_info->attrs[ATTR_DASHERIZED_NATIONAL];
+  }
+
+  VALUE result = rb_phone_number_format(self, NUMBER_FORMAT_DASHERIZED_NATIONAL);
+
+  return phone_number_attr_set(phone_number_info, ATTR_DASHERIZED_NATIONAL, result);
+}
+
+extern "C" VALUE rb_phone_number_country_code(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_COUNTRY_CODE)) {
+    return phone_number_info->attrs[ATTR_COUNTRY_CODE];
+  }
+
+  int code = phone_number_info->phone_number.country_code();
+
+  VALUE result = INT2NUM(code);
+
+  return phone_number_attr_set(phone_number_info, ATTR_COUNTRY_CODE, result);
+}
+
+extern "C" VALUE rb_phone_number_dasherized_international(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_DASHERIZED_INTERNATIONAL)) {
+    return phone_number_info->attrs[ATTR_DASHERIZED_INTERNATIONAL];
+  }
+
+  VALUE national = rb_phone_number_dasherized_national(self);
+  VALUE cc = country_code_string(phone_number_info->phone_number.country_code());
+  VALUE result = rb_str_buf_new(RSTRING_LEN(cc) + 1 + RSTRING_LEN(national));
+  rb_str_buf_append(result, cc);
+  rb_str_buf_cat(result, "-", 1);
+  rb_str_buf_append(result, national);
+
+  return phone_number_attr_set(phone_number_info, ATTR_DASHERIZED_INTERNATIONAL, result);
+}
+
+extern "C" VALUE rb_phone_number_raw_international(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_RAW_INTERNATIONAL)) {
+    return phone_number_info->attrs[ATTR_RAW_INTERNATIONAL];
+  }
+
+  VALUE national = rb_phone_number_raw_national(self);
+  VALUE cc = country_code_string(phone_number_info->phone_number.country_code());
+  VALUE result = rb_str_buf_new(RSTRING_LEN(cc) + RSTRING_LEN(national));
+  rb_str_buf_append(result, cc);
+  rb_str_buf_append(result, national);
+
+  return phone_number_attr_set(phone_number_info, ATTR_RAW_INTERNATIONAL, result);
+}
+
+extern "C" VALUE rb_phone_number_possible_eh(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_info->computed & FLAG_POSSIBLE_COMPUTED) {
+    return (phone_number_info->computed & FLAG_POSSIBLE) ? Qtrue : Qfalse;
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  bool possible = phone_util.IsPossibleNumber(phone_number_info->phone_number);
+
+  return phone_number_flag_set(phone_number_info, FLAG_POSSIBLE_COMPUTED, FLAG_POSSIBLE, possible);
+}
+
+extern "C" VALUE rb_phone_number_impossible_eh(VALUE self) {
+  return rb_phone_number_possible_eh(self) == Qtrue ? Qfalse : Qtrue;
+}
+
+extern "C" VALUE rb_phone_number_region_code(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_REGION_CODE)) {
+    return phone_number_info->attrs[ATTR_REGION_CODE];
+  }
+
+  VALUE input_region_code = phone_number_info->input_region_code;
+
+  if (NIL_P(input_region_code)) {
+    const RegionCode *region = region_code_for_country_code(phone_number_info->phone_number.country_code());
+
+    return phone_number_attr_set(phone_number_info, ATTR_REGION_CODE, region_code_string(region));
+  } else {
+    return phone_number_attr_set(phone_number_info, ATTR_REGION_CODE, input_region_code);
+  }
+}
+
+extern "C" VALUE rb_phone_number_match_eh(VALUE self, VALUE other) {
+  if (!rb_obj_is_kind_of(other, rb_cPhoneNumber)) {
+    return Qfalse;
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+
+  PhoneNumberInfo *self_info = phone_number_info_get(self);
+  PhoneNumberInfo *other_info = phone_number_info_get(other);
+
+  if (self_info->phone_number.raw_input() == other_info->phone_number.raw_input()) {
+    return Qtrue;
+  }
+
+  if (phone_util.IsNumberMatch(other_info->phone_number, self_info->phone_number) == PhoneNumberUtil::EXACT_MATCH) {
+    return Qtrue;
+  } else {
+    return Qfalse;
+  }
+}
+
+// Consistent with eql?: parsed numbers hash by their canonical fields (country
+// code, national number, leading zeros and extension), the others by input.
+extern "C" VALUE rb_phone_number_hash(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+  const std::string &raw_input = phone_number_info->phone_number.raw_input();
+  st_index_t hash;
+
+  if (phone_number_info_parsed(phone_number_info)) {
+    hash = rb_hash_start(static_cast<st_index_t>(packed_number_hash(phone_number_info->phone_number)));
+  } else {
+    hash = rb_hash_start(rb_memhash(raw_input.data(), raw_input.size()));
+  }
+
+  return ST2FIX(rb_hash_end(hash));
+}
+
+extern "C" VALUE rb_phone_number_eql_eh(VALUE self, VALUE other) {
+  if (!rb_obj_is_kind_of(other, rb_cPhoneNumber)) {
+    return Qfalse;
+  }
+
+  PhoneNumberInfo *self_info = phone_number_info_get(self);
+  PhoneNumberInfo *other_info = phone_number_info_get(other);
+  bool self_parsed = phone_number_info_parsed(self_info);
+
+  if (self_parsed != phone_number_info_parsed(other_info)) {
+    return Qfalse;
+  }
+
+  if (self_parsed) {
+    return packed_number_equal(self_info->phone_number, other_info->phone_number) ? Qtrue : Qfalse;
+  }
+
+  return self_info->phone_number.raw_input() == other_info->phone_number.raw_input() ? Qtrue : Qfalse;
+}
+
+extern "C" VALUE rb_phone_number_type(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_TYPE)) {
+    return phone_number_info->attrs[ATTR_TYPE];
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+
+  return phone_number_attr_set(phone_number_info, ATTR_TYPE,
+                               phone_number_type_symbol(number_type(phone_util, phone_number_info->phone_number)));
+}
+
+extern "C" VALUE rb_phone_number_area_code(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_attr_computed(phone_number_info, ATTR_AREA_CODE)) {
+    return phone_number_info->attrs[ATTR_AREA_CODE];
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+
+  PhoneNumber &number = phone_number_info->phone_number;
+  std::string national_significant_number;
+  phone_util.GetNationalSignificantNumber(number, &national_significant_number);
+  std::string area_code;
+  std::string subscriber_number;
+
+  int area_code_length = phone_util.GetLengthOfGeographicalAreaCode(number);
+  if (area_code_length > 0) {
+    area_code = national_significant_number.substr(0, area_code_length);
+    subscriber_number = national_significant_number.substr(area_code_length, std::string::npos);
+  } else {
+    area_code = "";
+    subscriber_number = national_significant_number;
+  }
+
+  VALUE result = rb_str_new(area_code.c_str(), area_code.size());
+
+  return phone_number_attr_set(phone_number_info, ATTR_AREA_CODE, result);
+}
+
+// Carrier and location
+//
+// Looked up in the prefix data loaded with MiniPhone.load_prefix_data. Like
+// libphonenumber's PhoneNumberToCarrierMapper and PhoneNumberOfflineGeocoder,
+// only valid numbers of a type which can have one get a carrier or location.
+// Results for the default locale ("en") are memoized.
+
+static inline bool phone_number_type_has_prefix_data(PrefixDataKind kind, PhoneNumberUtil::PhoneNumberType type) {
+  if (kind == PREFIX_DATA_CARRIER) {
+    return type == PhoneNumberUtil::MOBILE || type == PhoneNumberUtil::FIXED_LINE_OR_MOBILE ||
+           type == PhoneNumberUtil::PAGER;
+  }
+
+  return type == PhoneNumberUtil::FIXED_LINE || type == PhoneNumberUtil::MOBILE ||
+         type == PhoneNumberUtil::FIXED_LINE_OR_MOBILE;
+}
+
+static VALUE phone_number_prefix_description(PhoneNumberInfo *phone_number_info, PrefixDataKind kind, VALUE locale) {
+  if (!prefix_data_loaded()) {
+    rb_raise(rb_eRuntimeError, "no prefix data loaded, see MiniPhone.load_prefix_data");
+  }
+
+  if (SYMBOL_P(locale)) {
+    locale = rb_sym2str(locale);
+  } else if (!NIL_P(locale)) {
+    Check_Type(locale, T_STRING);
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  const PhoneNumber &number = phone_number_info->phone_number;
+
+  if (!phone_number_type_has_prefix_data(kind, number_type(phone_util, number))) {
+    return Qnil;
+  }
+
+  std::string national_significant_number;
+  phone_util.GetNationalSignificantNumber(number, &national_significant_number);
+
+  const char *description = prefix_data_lookup(
+      kind, NIL_P(locale) ? std::string("en") : std::string(RSTRING_PTR(locale), RSTRING_LEN(locale)),
+      number.country_code(), national_significant_number);
+
+  return description == nullptr ? Qnil : rb_utf8_str_new_cstr(description);
+}
+
+static inline VALUE phone_number_prefix_attr(int argc, VALUE *argv, VALUE self, PrefixDataKind kind,
+                                             PhoneNumberAttr attr) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+  VALUE locale;
+
+  rb_scan_args(argc, argv, "01", &locale);
+
+  if (!NIL_P(locale)) {
+    return phone_number_prefix_description(phone_number_info, kind, locale);
+  }
+
+  if (phone_number_attr_computed(phone_number_info, attr)) {
+    return phone_number_info->attrs[attr];
+  }
+
+  return phone_number_attr_set(phone_number_info, attr, phone_number_prefix_description(phone_number_info, kind, Qnil));
+}
+
+extern "C" VALUE rb_phone_number_carrier(int argc, VALUE *argv, VALUE self) {
+  return phone_number_prefix_attr(argc, argv, self, PREFIX_DATA_CARRIER, ATTR_CARRIER);
+}
+
+extern "C" VALUE rb_phone_number_location(int argc, VALUE *argv, VALUE self) {
+  return phone_number_prefix_attr(argc, argv, self, PREFIX_DATA_GEOCODING, ATTR_LOCATION);
+}
+
+extern "C" VALUE rb_phone_number_to_s(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+  const std::string &raw_input = phone_number_info->phone_number.raw_input();
+
+  return rb_str_new(raw_input.c_str(), raw_input.size());
+}
+
+static ID to_packed_kwarg_ids[1];
+
+extern "C" VALUE rb_phone_number_to_packed(int argc, VALUE *argv, VALUE self) {
+  static thread_local std::string packed;
+  VALUE opts;
+  VALUE kwargs[1];
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  rb_scan_args(argc, argv, "0:", &opts);
+
+  rb_get_kwargs(opts, to_packed_kwarg_ids, 0, 1, kwargs);
+
+  if (!phone_number_info_parsed(phone_number_info)) {
+    return Qnil;
+  }
+
+  packed_number_encode(phone_number_info->phone_number, kwargs[0] != Qundef && RTEST(kwargs[0]), &packed);
+
+  return rb_str_new(packed.data(), packed.size());
+}
+
+extern "C" VALUE rb_phone_number_to_packed_int(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+  uint64_t packed;
+
+  if (!phone_number_info_parsed(phone_number_info) ||
+      !packed_number_encode_int(phone_number_info->phone_number, &packed)) {
+    return Qnil;
+  }
+
+  return ULL2NUM(packed);
+}
+
+extern "C" VALUE rb_phone_number_from_packed(int argc, VALUE *argv, VALUE self) {
+  VALUE packed;
+  VALUE input_region_code;
+
+  rb_scan_args(argc, argv, "11", &packed, &input_region_code);
+
+  input_region_code = region_code_value(input_region_code);
+
+  VALUE pn = rb_phone_number_alloc(self);
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(pn);
+  PhoneNumber *phone_number = &phone_number_info->phone_number;
+  bool decoded;
+
+  phone_number_info->input_region_code = input_region_code;
+
+  if (RB_INTEGER_TYPE_P(packed)) {
+    uint64_t value;
+    // The sign, or +/-2 when the integer doesn't fit in 64 bits
+    int sign = rb_integer_pack(packed, &value, 1, sizeof(value), 0, INTEGER_PACK_NATIVE_BYTE_ORDER);
+
+    decoded = (sign == 0 || sign == 1) && packed_number_decode_int(value, phone_number);
+  } else {
+    StringValue(packed);
+    decoded = packed_number_decode(RSTRING_PTR(packed), RSTRING_LEN(packed), phone_number);
+  }
+
+  if (!decoded) {
+    rb_raise(rb_eArgError, "invalid packed phone number");
+  }
+
+  // Without the original input, #to_s falls back to the E.164 form
+  if (!phone_number->has_raw_input()) {
+    number_format(*phone_number, NUMBER_FORMAT_E164, phone_number->mutable_raw_input());
+
+    if (phone_number->has_extension()) {
+      phone_number->mutable_raw_input()->append(" ext. ");
+      phone_number->mutable_raw_input()->append(phone_number->extension());
+    }
+  }
+
+  return pn;
+}
+
+extern "C" VALUE rb_phone_number_valid_eh(VALUE self) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (phone_number_info->computed & FLAG_VALID_COMPUTED) {
+    return (phone_number_info->computed & FLAG_VALID) ? Qtrue : Qfalse;
+  }
+
+  VALUE input_region_code = phone_number_info->input_region_code;
+
+  if (NIL_P(input_region_code)) {
+    input_region_code = default_country();
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  const std::string &country_code = region_code_scratch(input_region_code);
+  bool valid = is_number_valid_for_region(phone_util, phone_number_info->phone_number, country_code);
+
+  return phone_number_flag_set(phone_number_info, FLAG_VALID_COMPUTED, FLAG_VALID, valid);
+}
+
+extern "C" VALUE rb_phone_number_invalid_eh(VALUE self) {
+  return rb_phone_number_valid_eh(self) == Qtrue ? Qfalse : Qtrue;
+}
+
+static inline VALUE rb_phone_number_assign(VALUE self, PhoneNumber *parsed_number, bool parsed_ok) {
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  if (!parsed_ok) {
+    rb_phone_number_nullify(self);
+  }
+
+  phone_number_info->phone_number.Swap(parsed_number);
+
+  return self;
+}
+
+extern "C" VALUE rb_phone_number_initialize(int argc, VALUE *argv, VALUE self) {
+  VALUE str;
+  VALUE input_region_code;
+  PhoneNumberInfo *phone_number_info = phone_number_info_get(self);
+
+  rb_scan_args(argc, argv, "11", &str, &input_region_code);
+  input_region_code = region_code_value(input_region_code);
+  phone_number_info->input_region_code = input_region_code;
+
+  if (NIL_P(input_region_code)) {
+    input_region_code = default_country();
+  }
 
   if (FIXNUM_P(str)) {
     str = rb_fix2str(str, 10);
   } else if (!RB_TYPE_P(str, T_STRING)) {
-    return rb_phone_number_nullify_ivars(self);
+    return rb_phone_number_nullify(self);
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  PhoneNumber &parsed_number = phone_number_info->phone_number;
+  bool parsed_ok;
+
+  const std::string &phone_number = *phone_number_scratch(str);
+  const std::string &country_code = region_code_scratch(input_region_code);
+
+  // Parse straight into the embedded message, no temporary needed
+  parsed_number.Clear();
+
+  if (parse_cache_enabled()) {
+    auto entry = parse_cache_fetch(phone_number, country_code);
+    parsed_number.CopyFrom(entry->number);
+    parsed_ok = entry->parsed_ok;
+  } else {
+    auto result = parse_keeping_raw_input(phone_util, phone_number, country_code, &parsed_number);
+    parsed_ok = result == PhoneNumberUtil::NO_PARSING_ERROR;
+  }
+
+  if (!parsed_ok) {
+    parsed_number.Clear();
+    rb_phone_number_nullify(self);
+  }
+
+  return self;
+}
+
+// Batch API
+//
+// The inputs are copied out of the Ruby array up front so the whole batch can
+// be parsed, validated and formatted without holding the GVL, optionally
+// spread over several threads of the native worker pool. Jobs are heap
+// allocated and freed with `rb_ensure`, since any Ruby call in between may
+// raise.
+
+// PhoneNumberMatch can't be copied, so matches are kept as these
+struct FoundNumber {
+  int start;
+  int end;
+  std::string raw_string;
+  PhoneNumber number;
+};
+
+struct BatchJob {
+  std::vector<std::string> numbers;
+  std::vector<char> skipped;
+  std::string country_code;
+  std::vector<char> valid;
+  std::vector<PhoneNumber> parsed;
+  std::vector<char> parsed_ok;
+  std::vector<std::string> formatted;
+  std::vector<PackedNumberKey> keys;
+  const NumberMatcher *matcher = nullptr;
+  std::vector<char> matches;
+  PhoneNumberMatcher::Leniency leniency = PhoneNumberMatcher::VALID;
+  std::vector<std::vector<FoundNumber>> found;
+  uint32_t columns = 0;
+  std::vector<NumberFormatStyle> formats;
+  std::vector<uint16_t> country_codes;
+  std::vector<uint8_t> types;
+  void (*process)(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i);
+  size_t threads = 1;
+  size_t cursor = 0;
+  std::atomic<bool> interrupted{false};
+  VALUE input_array;
+  VALUE input_region_code;
+  VALUE input_fields;
+};
+
+static VALUE batch_job_free(VALUE data) {
+  delete reinterpret_cast<BatchJob *>(data);
+
+  return Qnil;
+}
+
+static void batch_job_unblock(void *data) {
+  static_cast<BatchJob *>(data)->interrupted.store(true, std::memory_order_relaxed);
+}
+
+static void batch_job_load(BatchJob *job) {
+  long len = RARRAY_LEN(job->input_array);
+  VALUE input_region_code = job->input_region_code;
+
+  if (NIL_P(input_region_code)) {
+    input_region_code = default_country();
+  }
+
+  job->country_code.assign(RSTRING_PTR(input_region_code), RSTRING_LEN(input_region_code));
+  job->numbers.resize(len);
+  job->skipped.resize(len, 0);
+
+  for (long i = 0; i < len; i++) {
+    VALUE str = RARRAY_AREF(job->input_array, i);
+
+    if (FIXNUM_P(str)) {
+      str = rb_fix2str(str, 10);
+    } else if (!RB_TYPE_P(str, T_STRING)) {
+      job->skipped[i] = 1;
+      continue;
+    }
+
+    job->numbers[i].assign(RSTRING_PTR(str), RSTRING_LEN(str));
+  }
+}
+
+static void *batch_job_without_gvl(void *data) {
+  BatchJob *job = static_cast<BatchJob *>(data);
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+
+  job->cursor = worker_pool_run(job->cursor, job->numbers.size(), job->threads, &job->interrupted,
+                                [job, &phone_util](size_t begin, size_t end) {
+                                  for (size_t i = begin; i < end; i++) {
+                                    if (!job->skipped[i]) {
+                                      job->process(job, phone_util, i);
+                                    }
+                                  }
+                                });
+
+  return NULL;
+}
+
+static inline void batch_job_run(BatchJob *job, void (*process)(BatchJob *, const PhoneNumberUtil &, size_t)) {
+  if (job->numbers.empty()) {
+    return;
+  }
+
+  job->process = process;
+
+  // An interrupt stops the batch early so pending signals and Thread#raise get
+  // handled; if nothing raised, pick up again where the batch left off.
+  while (true) {
+    rb_thread_call_without_gvl(batch_job_without_gvl, job, batch_job_unblock, job);
+
+    if (!job->interrupted.load(std::memory_order_relaxed)) {
+      break;
+    }
+
+    rb_thread_check_ints();
+    job->interrupted.store(false, std::memory_order_relaxed);
+  }
+}
+
+static void batch_validate_one(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i) {
+  job->valid[i] = is_parsed_number_valid(phone_util, job->numbers[i], job->country_code);
+}
+
+static void batch_parse_one(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i) {
+  auto result = parse_keeping_raw_input(phone_util, job->numbers[i], job->country_code, &job->parsed[i]);
+
+  job->parsed_ok[i] = result == PhoneNumberUtil::NO_PARSING_ERROR;
+}
+
+static void batch_e164_one(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i) {
+  if (parse_cache_enabled()) {
+    auto entry = parse_cache_fetch(job->numbers[i], job->country_code);
+
+    if (entry->parsed_ok) {
+      std::call_once(entry->e164_once, [&] { number_format(entry->number, NUMBER_FORMAT_E164, &entry->e164); });
+      job->parsed_ok[i] = 1;
+      job->formatted[i] = entry->e164;
+    }
+
+    return;
+  }
+
+  PhoneNumber parsed_number;
+
+  auto result = parse_keeping_raw_input(phone_util, job->numbers[i], job->country_code, &parsed_number);
+
+  if (result == PhoneNumberUtil::NO_PARSING_ERROR) {
+    job->parsed_ok[i] = 1;
+    number_format(parsed_number, NUMBER_FORMAT_E164, &job->formatted[i]);
+  }
+}
+
+static void batch_normalize_digits_one(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i) {
+  normalize_digits(phone_util, job->numbers[i], &job->formatted[i]);
+}
+
+static VALUE batch_validate(VALUE data) {
+  BatchJob *job = reinterpret_cast<BatchJob *>(data);
+
+  batch_job_load(job);
+  job->valid.resize(job->numbers.size(), 0);
+  batch_job_run(job, batch_validate_one);
+
+  long len = static_cast<long>(job->numbers.size());
+  VALUE result = rb_ary_new_capa(len);
+
+  for (long i = 0; i < len; i++) {
+    rb_ary_push(result, job->valid[i] ? Qtrue : Qfalse);
+  }
+
+  return result;
+}
+
+static VALUE batch_parse(VALUE data) {
+  BatchJob *job = reinterpret_cast<BatchJob *>(data);
+
+  batch_job_load(job);
+  job->parsed.resize(job->numbers.size());
+  job->parsed_ok.resize(job->numbers.size(), 0);
+  batch_job_run(job, batch_parse_one);
+
+  long len = static_cast<long>(job->numbers.size());
+  VALUE result = rb_ary_new_capa(len);
+
+  for (long i = 0; i < len; i++) {
+    VALUE pn = rb_phone_number_alloc(rb_cPhoneNumber);
+    phone_number_info_get(pn)->input_region_code = job->input_region_code;
+
+    if (job->skipped[i]) {
+      rb_phone_number_nullify(pn);
+    } else {
+      rb_phone_number_assign(pn, &job->parsed[i], job->parsed_ok[i]);
+    }
+
+    rb_ary_push(result, pn);
+  }
+
+  return result;
+}
+
+static VALUE batch_e164(VALUE data) {
+  BatchJob *job = reinterpret_cast<BatchJob *>(data);
+
+  batch_job_load(job);
+  job->formatted.resize(job->numbers.size());
+  job->parsed_ok.resize(job->numbers.size(), 0);
+  batch_job_run(job, batch_e164_one);
+
+  long len = static_cast<long>(job->numbers.size());
+  VALUE result = rb_ary_new_capa(len);
+
+  for (long i = 0; i < len; i++) {
+    if (job->parsed_ok[i]) {
+      rb_ary_push(result, rb_str_new(job->formatted[i].c_str(), job->formatted[i].size()));
+    } else {
+      rb_ary_push(result, Qnil);
+    }
+  }
+
+  return result;
+}
+
+static VALUE batch_normalize_digits(VALUE data) {
+  BatchJob *job = reinterpret_cast<BatchJob *>(data);
+
+  batch_job_load(job);
+  job->formatted.resize(job->numbers.size());
+  batch_job_run(job, batch_normalize_digits_one);
+
+  long len = static_cast<long>(job->numbers.size());
+  VALUE result = rb_ary_new_capa(len);
+
+  for (long i = 0; i < len; i++) {
+    if (job->skipped[i]) {
+      rb_ary_push(result, Qnil);
+    } else {
+      rb_ary_push(result, rb_str_new(job->formatted[i].c_str(), job->formatted[i].size()));
+    }
+  }
+
+  return result;
+}
+
+static inline size_t batch_job_threads_value(VALUE threads) {
+  if (threads == Qundef || NIL_P(threads)) {
+    return 1;
+  }
+
+  long requested = NUM2LONG(threads);
+
+  if (requested < 1 || static_cast<size_t>(requested) > WORKER_POOL_MAX_THREADS) {
+    rb_raise(rb_eArgError, "threads must be between 1 and %zu", WORKER_POOL_MAX_THREADS);
+  }
+
+  return static_cast<size_t>(requested);
+}
+
+static ID threads_kwarg_ids[1];
+
+// Parses the `threads:` option of the batch methods
+static inline size_t batch_job_threads(VALUE opts) {
+  VALUE kwargs[1];
+
+  if (NIL_P(opts)) {
+    return 1;
+  }
+
+  rb_get_kwargs(opts, threads_kwarg_ids, 0, 1, kwargs);
+
+  return batch_job_threads_value(kwargs[0]);
+}
+
+static inline BatchJob *batch_job_new(int argc, VALUE *argv) {
+  VALUE ary;
+  VALUE input_region_code;
+  VALUE opts;
+
+  rb_scan_args(argc, argv, "11:", &ary, &input_region_code, &opts);
+  Check_Type(ary, T_ARRAY);
+
+  input_region_code = region_code_value(input_region_code);
+  size_t threads = batch_job_threads(opts);
+
+  BatchJob *job = new BatchJob();
+  job->input_array = ary;
+  job->input_region_code = input_region_code;
+  job->threads = threads;
+
+  return job;
+}
+
+extern "C" VALUE rb_is_phone_number_valid_many(int argc, VALUE *argv, VALUE self) {
+  BatchJob *job = batch_job_new(argc, argv);
+
+  return rb_ensure(batch_validate, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+}
+
+extern "C" VALUE rb_phone_number_parse_many(int argc, VALUE *argv, VALUE self) {
+  BatchJob *job = batch_job_new(argc, argv);
+
+  return rb_ensure(batch_parse, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+}
+
+extern "C" VALUE rb_phone_number_e164_many(int argc, VALUE *argv, VALUE self) {
+  BatchJob *job = batch_job_new(argc, argv);
+
+  return rb_ensure(batch_e164, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+}
+
+// No region is involved, so unlike the other batch methods this only takes the
+// array and `threads:`
+extern "C" VALUE rb_normalize_digits_many(int argc, VALUE *argv, VALUE self) {
+  VALUE ary;
+  VALUE opts;
+
+  rb_scan_args(argc, argv, "1:", &ary, &opts);
+  Check_Type(ary, T_ARRAY);
+
+  size_t threads = batch_job_threads(opts);
+
+  BatchJob *job = new BatchJob();
+  job->input_array = ary;
+  job->input_region_code = Qnil;
+  job->threads = threads;
+
+  return rb_ensure(batch_normalize_digits, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+}
+
+// Columnar results
+//
+// parse_columns computes only the requested fields and returns one column per
+// field instead of a PhoneNumber per row: an Array of Strings (or nil) for
+// the formats, and packed binary Strings for the rest. Country codes are
+// little endian uint16s, types are a byte per row (an index into
+// MiniPhone::TYPES) and booleans are bitmaps, least significant bit first.
+
+enum BatchColumn : uint32_t {
+  COLUMN_PARSED = 1u << 0,
+  COLUMN_VALID = 1u << 1,
+  COLUMN_COUNTRY_CODE = 1u << 2,
+  COLUMN_TYPE = 1u << 3,
+};
+
+static void batch_columns_one(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i) {
+  std::shared_ptr<ParseCacheEntry> entry;
+  PhoneNumber local_number;
+  const PhoneNumber *number = &local_number;
+
+  if (parse_cache_enabled()) {
+    entry = parse_cache_fetch(job->numbers[i], job->country_code);
+    number = &entry->number;
+
+    if (!entry->parsed_ok) {
+      return;
+    }
+  } else if (parse_keeping_raw_input(phone_util, job->numbers[i], job->country_code, &local_number) !=
+             PhoneNumberUtil::NO_PARSING_ERROR) {
+    return;
+  }
+
+  job->parsed_ok[i] = 1;
+
+  if (job->columns & COLUMN_COUNTRY_CODE) {
+    job->country_codes[i] = static_cast<uint16_t>(number->country_code());
+  }
+
+  if (job->columns & COLUMN_VALID) {
+    int8_t valid = entry ? entry->valid.load(std::memory_order_relaxed) : -1;
+
+    if (valid < 0) {
+      valid = is_number_valid_for_region(phone_util, *number, job->country_code);
+
+      if (entry) {
+        entry->valid.store(valid, std::memory_order_relaxed);
+      }
+    }
+
+    job->valid[i] = valid;
+  }
+
+  if (job->columns & COLUMN_TYPE) {
+    int8_t type = entry ? entry->type.load(std::memory_order_relaxed) : -1;
+
+    if (type < 0) {
+      type = static_cast<int8_t>(number_type(phone_util, *number));
+
+      if (entry) {
+        entry->type.store(type, std::memory_order_relaxed);
+      }
+    }
+
+    job->types[i] = static_cast<uint8_t>(type);
+  }
+
+  for (size_t f = 0; f < job->formats.size(); f++) {
+    number_format(*number, job->formats[f], &job->formatted[i * job->formats.size() + f]);
+  }
+}
+
+static inline VALUE batch_column_bitmap(const std::vector<char> &values) {
+  VALUE result = rb_str_new(NULL, static_cast<long>((values.size() + 7) / 8));
+  unsigned char *bytes = reinterpret_cast<unsigned char *>(RSTRING_PTR(result));
+
+  memset(bytes, 0, RSTRING_LEN(result));
+
+  for (size_t i = 0; i < values.size(); i++) {
+    if (values[i]) {
+      bytes[i / 8] |= static_cast<unsigned char>(1u << (i % 8));
+    }
+  }
+
+  return result;
+}
+
+static inline VALUE batch_column_country_codes(const std::vector<uint16_t> &values) {
+  VALUE result = rb_str_new(NULL, static_cast<long>(values.size() * 2));
+  unsigned char *bytes = reinterpret_cast<unsigned char *>(RSTRING_PTR(result));
+
+  for (size_t i = 0; i < values.size(); i++) {
+    bytes[i * 2] = static_cast<unsigned char>(values[i] & 0xff);
+    bytes[i * 2 + 1] = static_cast<unsigned char>(values[i] >> 8);
+  }
+
+  return result;
+}
+
+static inline VALUE batch_column_formatted(const BatchJob *job, size_t f) {
+  long len = static_cast<long>(job->numbers.size());
+  VALUE result = rb_ary_new_capa(len);
+
+  for (long i = 0; i < len; i++) {
+    if (job->parsed_ok[i]) {
+      const std::string &formatted = job->formatted[i * job->formats.size() + f];
+      rb_ary_push(result, rb_str_new(formatted.data(), formatted.size()));
+    } else {
+      rb_ary_push(result, Qnil);
+    }
+  }
+
+  return result;
+}
+
+static ID batch_column_ids[4];
+
+// The BatchColumn bit for a field, 0 for formats
+static inline uint32_t batch_column_value(VALUE field) {
+  for (int column = 0; column < 4; column++) {
+    if (SYM2ID(field) == batch_column_ids[column]) {
+      return 1u << column;
+    }
+  }
+
+  return 0;
+}
+
+// Reads the `fields:` option into the job, returns the fields in order
+static VALUE batch_columns_fields(BatchJob *job, VALUE fields) {
+  if (NIL_P(fields)) {
+    fields = rb_ary_new_from_args(4, ID2SYM(rb_intern("e164")), ID2SYM(rb_intern("country_code")),
+                                  ID2SYM(rb_intern("type")), ID2SYM(rb_intern("valid")));
+  }
+
+  Check_Type(fields, T_ARRAY);
+
+  for (long i = 0; i < RARRAY_LEN(fields); i++) {
+    VALUE field = RARRAY_AREF(fields, i);
+
+    if (!SYMBOL_P(field)) {
+      rb_raise(rb_eTypeError, "fields must be Symbols");
+    }
+
+    uint32_t column = batch_column_value(field);
+    VALUE name = rb_sym2str(field);
+    NumberFormatStyle style;
+
+    if (column != 0) {
+      job->columns |= column;
+    } else if (number_format_style_lookup(RSTRING_PTR(name), RSTRING_LEN(name), &style)) {
+      job->formats.push_back(style);
+    } else {
+      rb_raise(rb_eArgError, "unknown field: %" PRIsVALUE, field);
+    }
+  }
+
+  return fields;
+}
+
+static VALUE batch_columns(VALUE data) {
+  BatchJob *job = reinterpret_cast<BatchJob *>(data);
+  VALUE fields = batch_columns_fields(job, job->input_fields);
+  size_t len;
+
+  batch_job_load(job);
+  len = job->numbers.size();
+  job->parsed_ok.resize(len, 0);
+  job->valid.resize(job->columns & COLUMN_VALID ? len : 0, 0);
+  job->country_codes.resize(job->columns & COLUMN_COUNTRY_CODE ? len : 0, 0);
+  job->types.resize(job->columns & COLUMN_TYPE ? len : 0, PhoneNumberUtil::UNKNOWN);
+  job->formatted.resize(len * job->formats.size());
+  batch_job_run(job, batch_columns_one);
+
+  VALUE result = rb_hash_new();
+  size_t f = 0;
+
+  for (long i = 0; i < RARRAY_LEN(fields); i++) {
+    VALUE field = RARRAY_AREF(fields, i);
+    VALUE column;
+
+    switch (batch_column_value(field)) {
+    case COLUMN_PARSED:
+      column = batch_column_bitmap(job->parsed_ok);
+      break;
+    case COLUMN_VALID:
+      column = batch_column_bitmap(job->valid);
+      break;
+    case COLUMN_COUNTRY_CODE:
+      column = batch_column_country_codes(job->country_codes);
+      break;
+    case COLUMN_TYPE:
+      column = rb_str_new(reinterpret_cast<const char *>(job->types.data()), static_cast<long>(job->types.size()));
+      break;
+    default:
+      column = batch_column_formatted(job, f++);
+      break;
+    }
+
+    rb_hash_aset(result, field, column);
+  }
+
+  RB_GC_GUARD(fields);
+
+  return result;
+}
+
+static ID parse_columns_kwarg_ids[2];
+
+extern "C" VALUE rb_phone_number_parse_columns(int argc, VALUE *argv, VALUE self) {
+  VALUE ary;
+  VALUE input_region_code;
+  VALUE opts;
+  VALUE kwargs[2];
+
+  rb_scan_args(argc, argv, "11:", &ary, &input_region_code, &opts);
+  Check_Type(ary, T_ARRAY);
+
+  rb_get_kwargs(opts, parse_columns_kwarg_ids, 0, 2, kwargs);
+
+  input_region_code = region_code_value(input_region_code);
+  size_t threads = batch_job_threads_value(kwargs[1]);
+
+  BatchJob *job = new BatchJob();
+  job->input_array = ary;
+  job->input_region_code = input_region_code;
+  job->input_fields = kwargs[0] == Qundef ? Qnil : kwargs[0];
+  job->threads = threads;
+
+  return rb_ensure(batch_columns, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+}
+
+// NumberSet
+//
+// A set of canonical number keys (see packed_number_key), for deduplicating
+// large lists without keeping a PhoneNumber object around per entry. Strings
+// are parsed with the set's region code, or the default country.
+
+struct NumberSetInfo {
+  NumberSet set;
+  VALUE input_region_code;
+};
+
+extern "C" size_t number_set_info_size(const void *data) {
+  const NumberSetInfo *number_set_info = static_cast<const NumberSetInfo *>(data);
+
+  return sizeof(NumberSetInfo) + number_set_info->set.memsize();
+}
+
+extern "C" void number_set_info_mark(void *data) {
+  rb_gc_mark_movable(static_cast<NumberSetInfo *>(data)->input_region_code);
+}
+
+extern "C" void number_set_info_compact(void *data) {
+  NumberSetInfo *number_set_info = static_cast<NumberSetInfo *>(data);
+
+  number_set_info->input_region_code = rb_gc_location(number_set_info->input_region_code);
+}
+
+extern "C" void number_set_info_free(void *data) {
+  NumberSetInfo *number_set_info = static_cast<NumberSetInfo *>(data);
+
+  number_set_info->~NumberSetInfo();
+  xfree(data);
+}
+
+extern "C" const rb_data_type_t number_set_info_type = {
+    .wrap_struct_name = "MiniPhone/NumberSetInfo",
+    .function =
+        {
+            .dmark = number_set_info_mark,
+            .dfree = number_set_info_free,
+            .dsize = number_set_info_size,
+            .dcompact = number_set_info_compact,
+        },
+    .parent = NULL,
+    .data = NULL,
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static inline NumberSetInfo *number_set_info_get(VALUE self) {
+  NumberSetInfo *number_set_info;
+  TypedData_Get_Struct(self, NumberSetInfo, &number_set_info_type, number_set_info);
+
+  return number_set_info;
+}
+
+// Parses `phone_number` and fills in its canonical key, which is left empty
+// when it can't be parsed. Safe to call without the GVL.
+static void parsed_number_key(const PhoneNumberUtil &phone_util, const std::string &phone_number,
+                              const std::string &country_code, PackedNumberKey *key) {
+  bool region_valid = region_code_valid_for_parsing(country_code.data(), country_code.size());
+  uint64_t national_number;
+  PhoneNumber parsed_number;
+
+  switch (number_shape(phone_number.data(), phone_number.size(), region_valid, &national_number)) {
+  case NUMBER_SHAPE_JUNK:
+    return;
+  case NUMBER_SHAPE_NANP_E164:
+    parsed_number.set_country_code(1);
+    parsed_number.set_national_number(national_number);
+    packed_number_key(parsed_number, key);
+    return;
+  case NUMBER_SHAPE_OTHER:
+    break;
+  }
+
+  if (parse_cache_enabled()) {
+    auto entry = parse_cache_fetch(phone_number, country_code);
+
+    if (entry->parsed_ok) {
+      packed_number_key(entry->number, key);
+    }
+
+    return;
+  }
+
+  if (parse_number(phone_util, phone_number, country_code, &parsed_number) == PhoneNumberUtil::NO_PARSING_ERROR) {
+    packed_number_key(parsed_number, key);
+  }
+}
+
+static inline VALUE number_set_region_code(NumberSetInfo *number_set_info) {
+  VALUE input_region_code = number_set_info->input_region_code;
+
+  return NIL_P(input_region_code) ? default_country() : input_region_code;
+}
+
+static void number_set_key(NumberSetInfo *number_set_info, VALUE number, PackedNumberKey *key) {
+  if (rb_obj_is_kind_of(number, rb_cPhoneNumber)) {
+    PhoneNumberInfo *phone_number_info = phone_number_info_get(number);
+
+    if (phone_number_info_parsed(phone_number_info)) {
+      packed_number_key(phone_number_info->phone_number, key);
+    }
+
+    return;
+  }
+
+  if (FIXNUM_P(number)) {
+    number = rb_fix2str(number, 10);
+  } else if (!RB_TYPE_P(number, T_STRING)) {
+    return;
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+
+  parsed_number_key(phone_util, *phone_number_scratch(number),
+                    region_code_scratch(number_set_region_code(number_set_info)), key);
+}
+
+extern "C" VALUE rb_number_set_alloc(VALUE self) {
+  void *data = ALLOC(NumberSetInfo);
+  NumberSetInfo *number_set_info = new (data) NumberSetInfo();
+  number_set_info->input_region_code = Qnil;
+
+  return TypedData_Wrap_Struct(self, &number_set_info_type, number_set_info);
+}
+
+extern "C" VALUE rb_number_set_initialize(int argc, VALUE *argv, VALUE self) {
+  VALUE input_region_code;
+
+  rb_scan_args(argc, argv, "01", &input_region_code);
+
+  number_set_info_get(self)->input_region_code = region_code_value(input_region_code);
+
+  return self;
+}
+
+// Returns true when the number was added, false when it was already in the
+// set and nil when it can't be parsed.
+extern "C" VALUE rb_number_set_add(VALUE self, VALUE number) {
+  NumberSetInfo *number_set_info = number_set_info_get(self);
+  PackedNumberKey key;
+
+  number_set_key(number_set_info, number, &key);
+
+  if (key.empty()) {
+    return Qnil;
+  }
+
+  return number_set_info->set.insert(key) ? Qtrue : Qfalse;
+}
+
+extern "C" VALUE rb_number_set_include_eh(VALUE self, VALUE number) {
+  NumberSetInfo *number_set_info = number_set_info_get(self);
+  PackedNumberKey key;
+
+  number_set_key(number_set_info, number, &key);
+
+  return !key.empty() && number_set_info->set.contains(key) ? Qtrue : Qfalse;
+}
+
+static void batch_key_one(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i) {
+  parsed_number_key(phone_util, job->numbers[i], job->country_code, &job->keys[i]);
+}
+
+struct NumberSetAddAll {
+  BatchJob *job;
+  NumberSet *set;
+};
+
+static VALUE number_set_add_all(VALUE data) {
+  NumberSetAddAll *add_all = reinterpret_cast<NumberSetAddAll *>(data);
+  BatchJob *job = add_all->job;
+  size_t added = 0;
+
+  batch_job_load(job);
+  job->keys.resize(job->numbers.size());
+
+  long len = static_cast<long>(job->numbers.size());
+
+  // PhoneNumber objects are already parsed, so only the strings go through
+  // the (GVL free) batch
+  for (long i = 0; i < len; i++) {
+    VALUE number = RARRAY_AREF(job->input_array, i);
+
+    if (rb_obj_is_kind_of(number, rb_cPhoneNumber)) {
+      PhoneNumberInfo *phone_number_info = phone_number_info_get(number);
+
+      if (phone_number_info_parsed(phone_number_info)) {
+        packed_number_key(phone_number_info->phone_number, &job->keys[i]);
+      }
+    }
+  }
+
+  batch_job_run(job, batch_key_one);
+
+  // No reserve up front: most of a list being deduplicated is usually
+  // duplicates, so the table only grows with what's actually new
+  for (const PackedNumberKey &key : job->keys) {
+    if (!key.empty() && add_all->set->insert(key)) {
+      added++;
+    }
+  }
+
+  return SIZET2NUM(added);
+}
+
+// Adds every number of the array, returns how many of them were new.
+extern "C" VALUE rb_number_set_add_all(int argc, VALUE *argv, VALUE self) {
+  VALUE ary;
+  VALUE opts;
+
+  rb_scan_args(argc, argv, "1:", &ary, &opts);
+  Check_Type(ary, T_ARRAY);
+
+  NumberSetInfo *number_set_info = number_set_info_get(self);
+  size_t threads = batch_job_threads(opts);
+  BatchJob *job = new BatchJob();
+  job->input_array = ary;
+  job->input_region_code = number_set_region_code(number_set_info);
+  job->threads = threads;
+
+  NumberSetAddAll add_all = {job, &number_set_info->set};
+
+  return rb_ensure(number_set_add_all, reinterpret_cast<VALUE>(&add_all), batch_job_free,
+                   reinterpret_cast<VALUE>(job));
+}
+
+extern "C" VALUE rb_number_set_size(VALUE self) { return SIZET2NUM(number_set_info_get(self)->set.size()); }
+
+extern "C" VALUE rb_number_set_clear(VALUE self) {
+  number_set_info_get(self)->set.clear();
+
+  return self;
+}
+
+// Matcher
+//
+// Reconciles candidates against a fixed set of reference numbers, reporting
+// the best IsNumberMatch result per candidate. Like IsNumberMatchWithOneString,
+// candidates written without a country calling code are parsed with the
+// matcher's region and compared by national number only, so they match at
+// most as :nsn_match.
+
+struct MatcherInfo {
+  NumberMatcher matcher;
+  VALUE input_region_code;
+};
+
+extern "C" size_t matcher_info_size(const void *data) {
+  const MatcherInfo *matcher_info = static_cast<const MatcherInfo *>(data);
+
+  return sizeof(MatcherInfo) + matcher_info->matcher.memory_size();
+}
+
+extern "C" void matcher_info_mark(void *data) {
+  rb_gc_mark_movable(static_cast<MatcherInfo *>(data)->input_region_code);
+}
+
+extern "C" void matcher_info_compact(void *data) {
+  MatcherInfo *matcher_info = static_cast<MatcherInfo *>(data);
+
+  matcher_info->input_region_code = rb_gc_location(matcher_info->input_region_code);
+}
+
+extern "C" void matcher_info_free(void *data) {
+  MatcherInfo *matcher_info = static_cast<MatcherInfo *>(data);
+
+  matcher_info->~MatcherInfo();
+  xfree(data);
+}
+
+extern "C" const rb_data_type_t matcher_info_type = {
+    .wrap_struct_name = "MiniPhone/MatcherInfo",
+    .function =
+        {
+            .dmark = matcher_info_mark,
+            .dfree = matcher_info_free,
+            .dsize = matcher_info_size,
+            .dcompact = matcher_info_compact,
+        },
+    .parent = NULL,
+    .data = NULL,
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static inline MatcherInfo *matcher_info_get(VALUE self) {
+  MatcherInfo *matcher_info;
+  TypedData_Get_Struct(self, MatcherInfo, &matcher_info_type, matcher_info);
+
+  return matcher_info;
+}
+
+extern "C" VALUE rb_matcher_alloc(VALUE self) {
+  void *data = ALLOC(MatcherInfo);
+  MatcherInfo *matcher_info = new (data) MatcherInfo();
+  matcher_info->input_region_code = Qnil;
+
+  return TypedData_Wrap_Struct(self, &matcher_info_type, matcher_info);
+}
+
+// Copies the numbers of the array which are already parsed PhoneNumber
+// objects into the job, the batch takes care of the strings.
+static void batch_job_load_phone_numbers(BatchJob *job) {
+  long len = static_cast<long>(job->numbers.size());
+
+  for (long i = 0; i < len; i++) {
+    VALUE number = RARRAY_AREF(job->input_array, i);
+
+    if (rb_obj_is_kind_of(number, rb_cPhoneNumber)) {
+      PhoneNumberInfo *phone_number_info = phone_number_info_get(number);
+
+      if (phone_number_info_parsed(phone_number_info)) {
+        job->parsed[i] = phone_number_info->phone_number;
+        job->parsed_ok[i] = 1;
+      }
+    }
+  }
+}
+
+static VALUE matcher_build(VALUE data) {
+  BatchJob *job = reinterpret_cast<BatchJob *>(data);
+  NumberMatcher *matcher = const_cast<NumberMatcher *>(job->matcher);
+
+  batch_job_load(job);
+  job->parsed.resize(job->numbers.size());
+  job->parsed_ok.resize(job->numbers.size(), 0);
+  batch_job_load_phone_numbers(job);
+  batch_job_run(job, batch_parse_one);
+
+  for (size_t i = 0; i < job->parsed.size(); i++) {
+    if (job->parsed_ok[i]) {
+      matcher->add(job->parsed[i]);
+    }
+  }
+
+  matcher->build();
+
+  return Qnil;
+}
+
+extern "C" VALUE rb_matcher_initialize(int argc, VALUE *argv, VALUE self) {
+  MatcherInfo *matcher_info = matcher_info_get(self);
+  BatchJob *job = batch_job_new(argc, argv);
+  VALUE input_region_code = job->input_region_code;
+
+  if (NIL_P(input_region_code)) {
+    input_region_code = default_country();
+  }
+
+  matcher_info->matcher = NumberMatcher();
+  matcher_info->input_region_code = input_region_code;
+  job->matcher = &matcher_info->matcher;
+
+  rb_ensure(matcher_build, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+
+  return self;
+}
+
+static void batch_match_one(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i) {
+  PhoneNumber &candidate = job->parsed[i];
+
+  if (!job->parsed_ok[i]) {
+    auto result = parse_number(phone_util, job->numbers[i], "ZZ", &candidate);
+
+    if (result == PhoneNumberUtil::INVALID_COUNTRY_CODE_ERROR) {
+      result = parse_number(phone_util, job->numbers[i], job->country_code, &candidate);
+      candidate.set_country_code(0);
+    }
+
+    if (result != PhoneNumberUtil::NO_PARSING_ERROR) {
+      return;
+    }
+  }
+
+  job->matches[i] = static_cast<char>(job->matcher->match(candidate));
+}
+
+static ID match_ids[3];
+
+static VALUE matcher_match(VALUE data) {
+  BatchJob *job = reinterpret_cast<BatchJob *>(data);
+
+  batch_job_load(job);
+  job->parsed.resize(job->numbers.size());
+  job->parsed_ok.resize(job->numbers.size(), 0);
+  job->matches.resize(job->numbers.size(), PhoneNumberUtil::NO_MATCH);
+  batch_job_load_phone_numbers(job);
+  batch_job_run(job, batch_match_one);
+
+  long len = static_cast<long>(job->numbers.size());
+  VALUE result = rb_ary_new_capa(len);
+
+  for (long i = 0; i < len; i++) {
+    // PhoneNumber objects are skipped by the batch, match them here
+    if (job->skipped[i] && job->parsed_ok[i]) {
+      job->matches[i] = static_cast<char>(job->matcher->match(job->parsed[i]));
+    }
+
+    switch (job->matches[i]) {
+    case PhoneNumberUtil::SHORT_NSN_MATCH:
+      rb_ary_push(result, ID2SYM(match_ids[0]));
+      break;
+    case PhoneNumberUtil::NSN_MATCH:
+      rb_ary_push(result, ID2SYM(match_ids[1]));
+      break;
+    case PhoneNumberUtil::EXACT_MATCH:
+      rb_ary_push(result, ID2SYM(match_ids[2]));
+      break;
+    default:
+      rb_ary_push(result, Qnil);
+      break;
+    }
+  }
+
+  return result;
+}
+
+extern "C" VALUE rb_matcher_match(int argc, VALUE *argv, VALUE self) {
+  VALUE ary;
+  VALUE opts;
+
+  rb_scan_args(argc, argv, "1:", &ary, &opts);
+  Check_Type(ary, T_ARRAY);
+
+  MatcherInfo *matcher_info = matcher_info_get(self);
+  size_t threads = batch_job_threads(opts);
+  BatchJob *job = new BatchJob();
+  job->input_array = ary;
+  job->input_region_code = matcher_info->input_region_code;
+  job->threads = threads;
+  job->matcher = &matcher_info->matcher;
+
+  return rb_ensure(matcher_match, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+}
+
+extern "C" VALUE rb_matcher_size(VALUE self) { return SIZET2NUM(matcher_info_get(self)->matcher.size()); }
+
+// AsYouType
+//
+// Wraps libphonenumber's AsYouTypeFormatter, which keeps the state of the
+// number being typed so each keystroke only does the work for one more
+// character. It has no way of taking a character back, so `remove_last`
+// replays the input minus the last character (numbers are short).
+
+struct AsYouTypeInfo {
+  AsYouTypeFormatter *formatter;
+  std::vector<char32> input;
+  std::string result;
+};
+
+extern "C" size_t as_you_type_info_size(const void *data) {
+  const AsYouTypeInfo *as_you_type_info = static_cast<const AsYouTypeInfo *>(data);
+
+  return sizeof(AsYouTypeInfo) + as_you_type_info->input.capacity() * sizeof(char32) +
+         as_you_type_info->result.capacity();
+}
+
+extern "C" void as_you_type_info_free(void *data) {
+  AsYouTypeInfo *as_you_type_info = static_cast<AsYouTypeInfo *>(data);
+
+  delete as_you_type_info->formatter;
+  as_you_type_info->~AsYouTypeInfo();
+  xfree(data);
+}
+
+extern "C" const rb_data_type_t as_you_type_info_type = {
+    .wrap_struct_name = "MiniPhone/AsYouTypeInfo",
+    .function =
+        {
+            .dmark = NULL,
+            .dfree = as_you_type_info_free,
+            .dsize = as_you_type_info_size,
+        },
+    .parent = NULL,
+    .data = NULL,
+    .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static inline AsYouTypeInfo *as_you_type_info_get(VALUE self) {
+  AsYouTypeInfo *as_you_type_info;
+  TypedData_Get_Struct(self, AsYouTypeInfo, &as_you_type_info_type, as_you_type_info);
+
+  if (as_you_type_info->formatter == nullptr) {
+    rb_raise(rb_eRuntimeError, "uninitialized MiniPhone::AsYouType");
+  }
+
+  return as_you_type_info;
+}
+
+extern "C" VALUE rb_as_you_type_alloc(VALUE self) {
+  void *data = ALLOC(AsYouTypeInfo);
+  AsYouTypeInfo *as_you_type_info = new (data) AsYouTypeInfo();
+  as_you_type_info->formatter = nullptr;
+
+  return TypedData_Wrap_Struct(self, &as_you_type_info_type, as_you_type_info);
+}
+
+extern "C" VALUE rb_as_you_type_initialize(int argc, VALUE *argv, VALUE self) {
+  AsYouTypeInfo *as_you_type_info;
+  VALUE input_region_code;
+
+  rb_scan_args(argc, argv, "01", &input_region_code);
+  TypedData_Get_Struct(self, AsYouTypeInfo, &as_you_type_info_type, as_you_type_info);
+
+  input_region_code = region_code_value(input_region_code);
+
+  if (NIL_P(input_region_code)) {
+    input_region_code = default_country();
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  const std::string &region_code = region_code_scratch(input_region_code);
+
+  delete as_you_type_info->formatter;
+  as_you_type_info->formatter = phone_util.GetAsYouTypeFormatter(region_code);
+  as_you_type_info->input.clear();
+  as_you_type_info->result.clear();
+
+  return self;
+}
+
+static inline VALUE as_you_type_result(const AsYouTypeInfo *as_you_type_info) {
+  return rb_str_new(as_you_type_info->result.data(), as_you_type_info->result.size());
+}
+
+static inline void as_you_type_input(AsYouTypeInfo *as_you_type_info, char32 c) {
+  as_you_type_info->input.push_back(c);
+  as_you_type_info->formatter->InputDigit(c, &as_you_type_info->result);
+}
+
+// Characters are read as UTF-8, so full width digits work like they do for
+// the rest of libphonenumber. Strings in other encodings are converted first.
+static inline VALUE as_you_type_utf8_string(VALUE str) {
+  Check_Type(str, T_STRING);
+
+  return rb_str_conv_enc(str, rb_enc_get(str), rb_utf8_encoding());
+}
+
+extern "C" VALUE rb_as_you_type_input_digit(VALUE self, VALUE digit) {
+  AsYouTypeInfo *as_you_type_info = as_you_type_info_get(self);
+  VALUE str = as_you_type_utf8_string(digit);
+  const char *ptr = RSTRING_PTR(str);
+  const char *end = ptr + RSTRING_LEN(str);
+  int len;
+
+  if (ptr == end) {
+    rb_raise(rb_eArgError, "expected a single character, got an empty string");
+  }
+
+  unsigned int c = rb_enc_codepoint_len(ptr, end, &len, rb_utf8_encoding());
+
+  if (ptr + len != end) {
+    rb_raise(rb_eArgError, "expected a single character, got %" PRIsVALUE, rb_inspect(digit));
+  }
+
+  as_you_type_input(as_you_type_info, static_cast<char32>(c));
+
+  RB_GC_GUARD(str);
+
+  return as_you_type_result(as_you_type_info);
+}
+
+extern "C" VALUE rb_as_you_type_input(VALUE self, VALUE input) {
+  AsYouTypeInfo *as_you_type_info = as_you_type_info_get(self);
+  VALUE str = as_you_type_utf8_string(input);
+  const char *ptr = RSTRING_PTR(str);
+  const char *end = ptr + RSTRING_LEN(str);
+
+  while (ptr < end) {
+    int len;
+    unsigned int c = rb_enc_codepoint_len(ptr, end, &len, rb_utf8_encoding());
+
+    as_you_type_input(as_you_type_info, static_cast<char32>(c));
+    ptr += len;
+  }
+
+  RB_GC_GUARD(str);
+
+  return as_you_type_result(as_you_type_info);
+}
+
+extern "C" VALUE rb_as_you_type_remove_last(VALUE self) {
+  AsYouTypeInfo *as_you_type_info = as_you_type_info_get(self);
+  std::vector<char32> &input = as_you_type_info->input;
+
+  if (input.empty()) {
+    return as_you_type_result(as_you_type_info);
+  }
+
+  input.pop_back();
+  as_you_type_info->formatter->Clear();
+  as_you_type_info->result.clear();
+
+  for (char32 c : input) {
+    as_you_type_info->formatter->InputDigit(c, &as_you_type_info->result);
+  }
+
+  return as_you_type_result(as_you_type_info);
+}
+
+extern "C" VALUE rb_as_you_type_clear(VALUE self) {
+  AsYouTypeInfo *as_you_type_info = as_you_type_info_get(self);
+
+  as_you_type_info->formatter->Clear();
+  as_you_type_info->input.clear();
+  as_you_type_info->result.clear();
+
+  return self;
+}
+
+extern "C" VALUE rb_as_you_type_to_s(VALUE self) { return as_you_type_result(as_you_type_info_get(self)); }
+
+// Finding numbers in text
+//
+// Built on PhoneNumberMatcher. A single text goes through the batch machinery
+// as a batch of one, so large texts are scanned without holding the GVL too.
+// Offsets are converted from bytes to characters once back in Ruby.
+
+static void batch_find_one(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i) {
+  PhoneNumberMatcher matcher(phone_util, job->numbers[i], job->country_code, job->leniency, INT_MAX);
+  PhoneNumberMatch match;
+
+  while (matcher.Next(&match)) {
+    job->found[i].push_back(FoundNumber{match.start(), match.end(), match.raw_string(), match.number()});
+  }
+}
+
+static VALUE find_numbers_results(BatchJob *job, size_t i) {
+  const std::vector<FoundNumber> &found = job->found[i];
+  VALUE result = rb_ary_new_capa(static_cast<long>(found.size()));
+
+  if (job->skipped[i]) {
+    return result;
+  }
+
+  VALUE text = RARRAY_AREF(job->input_array, i);
+
+  for (const FoundNumber &match : found) {
+    VALUE pn = rb_phone_number_alloc(rb_cPhoneNumber);
+    PhoneNumberInfo *phone_number_info = phone_number_info_get(pn);
+    phone_number_info->phone_number = match.number;
+    phone_number_info->input_region_code = job->input_region_code;
+
+    VALUE raw = rb_enc_str_new(match.raw_string.data(), match.raw_string.size(), rb_enc_get(text));
+
+    rb_ary_push(result, rb_struct_new(rb_cNumberMatch, LONG2NUM(rb_str_sublen(text, match.start)),
+                                      LONG2NUM(rb_str_sublen(text, match.end)), raw, pn));
+  }
+
+  return result;
+}
+
+static VALUE find_numbers(VALUE data) {
+  BatchJob *job = reinterpret_cast<BatchJob *>(data);
+
+  batch_job_load(job);
+  job->found.resize(job->numbers.size());
+  batch_job_run(job, batch_find_one);
+
+  long len = static_cast<long>(job->numbers.size());
+  VALUE result = rb_ary_new_capa(len);
+
+  for (long i = 0; i < len; i++) {
+    rb_ary_push(result, find_numbers_results(job, i));
+  }
+
+  return result;
+}
+
+static ID leniency_ids[4];
+
+static inline PhoneNumberMatcher::Leniency find_numbers_leniency(VALUE leniency) {
+  if (leniency == Qundef || NIL_P(leniency)) {
+    return PhoneNumberMatcher::VALID;
+  }
+
+  ID id = SYMBOL_P(leniency) ? SYM2ID(leniency) : 0;
+
+  if (id == leniency_ids[0]) {
+    return PhoneNumberMatcher::POSSIBLE;
+  } else if (id == leniency_ids[1]) {
+    return PhoneNumberMatcher::VALID;
+  } else if (id == leniency_ids[2]) {
+    return PhoneNumberMatcher::STRICT_GROUPING;
+  } else if (id == leniency_ids[3]) {
+    return PhoneNumberMatcher::EXACT_GROUPING;
+  }
+
+  rb_raise(rb_eArgError, "unknown leniency: %" PRIsVALUE, leniency);
+}
+
+static ID find_numbers_kwarg_ids[2];
+
+// Parses (text(s), country = nil, leniency: :valid, threads: 1). A single text
+// is wrapped into `texts`, otherwise the first argument must be an array.
+static inline BatchJob *find_numbers_job_new(int argc, VALUE *argv, VALUE texts) {
+  VALUE input;
+  VALUE input_region_code;
+  VALUE opts;
+  VALUE kwargs[2];
+
+  rb_scan_args(argc, argv, "11:", &input, &input_region_code, &opts);
+
+  if (NIL_P(texts)) {
+    Check_Type(input, T_ARRAY);
+  } else {
+    if (!NIL_P(input)) {
+      Check_Type(input, T_STRING);
+    }
+
+    rb_ary_push(texts, input);
+    input = texts;
+  }
+
+  rb_get_kwargs(opts, find_numbers_kwarg_ids, 0, 2, kwargs);
+
+  PhoneNumberMatcher::Leniency leniency = find_numbers_leniency(kwargs[0]);
+  size_t threads = batch_job_threads_value(kwargs[1]);
+  input_region_code = region_code_value(input_region_code);
+
+  BatchJob *job = new BatchJob();
+  job->input_array = input;
+  job->input_region_code = input_region_code;
+  job->leniency = leniency;
+  job->threads = threads;
+
+  return job;
+}
+
+extern "C" VALUE rb_find_numbers(int argc, VALUE *argv, VALUE self) {
+  VALUE texts = rb_ary_new_capa(1);
+  BatchJob *job = find_numbers_job_new(argc, argv, texts);
+  VALUE result = rb_ensure(find_numbers, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+
+  RB_GC_GUARD(texts);
+
+  return rb_ary_entry(result, 0);
+}
+
+extern "C" VALUE rb_find_numbers_many(int argc, VALUE *argv, VALUE self) {
+  BatchJob *job = find_numbers_job_new(argc, argv, Qnil);
+
+  return rb_ensure(find_numbers, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+}
+
+// Streaming API
+//
+// Input is read in large chunks (or mmapped when given a path), and the
+// lines are split, parsed and formatted without holding the GVL. Output is
+// written back in chunks, so only a couple of Ruby strings get allocated per
+// megabyte of input.
+
+static const size_t STREAM_CHUNK_SIZE = 1 << 20;
+
+struct StreamJob {
+  StreamNormalizer normalizer;
+  VALUE input;
+  VALUE output;
+  VALUE path;
+  VALUE read_buffer;
+  // Holds the file opened for `path`, which nothing else references
+  VALUE opened;
+  const char *mapped = nullptr;
+  size_t mapped_size = 0;
+  int fd = -1;
+  bool close_input = false;
+  const char *data = nullptr;
+  size_t len = 0;
+  size_t consumed = 0;
+  bool final = false;
+  std::string pending;
+  std::string out;
+  size_t bytes_read = 0;
+  size_t bytes_written = 0;
+  std::atomic<bool> interrupted{false};
+};
+
+static VALUE stream_job_free(VALUE data) {
+  StreamJob *job = reinterpret_cast<StreamJob *>(data);
+
+#ifdef HAVE_SYS_MMAN_H
+  if (job->mapped) {
+    munmap(const_cast<char *>(job->mapped), job->mapped_size);
+  }
+
+  if (job->fd >= 0) {
+    close(job->fd);
+  }
+#endif
+
+  if (job->close_input) {
+    rb_io_close(job->input);
+  }
+
+  delete job;
+
+  return Qnil;
+}
+
+static void stream_job_unblock(void *data) {
+  static_cast<StreamJob *>(data)->interrupted.store(true, std::memory_order_relaxed);
+}
+
+static void *stream_job_without_gvl(void *data) {
+  StreamJob *job = static_cast<StreamJob *>(data);
+
+  job->consumed += job->normalizer.process(job->data + job->consumed, job->len - job->consumed, job->final, &job->out,
+                                           &job->interrupted);
+
+  return NULL;
+}
+
+// Maps the file at `path` into `job` when possible. Returns false for files
+// that can't be mapped (pipes, FIFOs, ...), which are read like any other IO.
+static bool stream_job_map(StreamJob *job, VALUE path) {
+#ifdef HAVE_SYS_MMAN_H
+  int fd = open(RSTRING_PTR(path), O_RDONLY);
+
+  if (fd < 0) {
+    rb_sys_fail_str(path);
   }
 
-  PhoneNumberInfo *phone_number_info;
+  struct stat st;
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    size_t size = static_cast<size_t>(st.st_size);
+    void *mapped = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+
+    if (mapped != MAP_FAILED) {
+      if (mapped) {
+        madvise(mapped, size, MADV_SEQUENTIAL);
+      }
+
+      job->fd = fd;
+      job->mapped = static_cast<const char *>(mapped);
+      job->mapped_size = size;
+
+      return true;
+    }
+  }
+
+  close(fd);
+#endif
+
+  return false;
+}
+
+static void stream_job_flush(StreamJob *job) {
+  if (job->out.empty()) {
+    return;
+  }
+
+  rb_funcall(job->output, rb_intern("write"), 1, rb_str_new(job->out.data(), job->out.size()));
+  job->bytes_written += job->out.size();
+  job->out.clear();
+}
+
+// Loads the next chunk, returns false once the input is exhausted.
+static bool stream_job_fill(StreamJob *job) {
+  if (job->final) {
+    return false;
+  }
+
+  if (NIL_P(job->input)) {
+    size_t offset = job->data ? static_cast<size_t>(job->data - job->mapped) + job->consumed : 0;
+    size_t remaining = job->mapped_size - offset;
+    // Lines longer than a chunk grow the window until they fit
+    size_t window = job->consumed == 0 && job->data ? job->len * 2 : STREAM_CHUNK_SIZE;
+
+    job->data = job->mapped + offset;
+    job->len = remaining < window ? remaining : window;
+    job->final = job->len == remaining;
+    job->bytes_read = offset + job->len;
+  } else {
+    job->pending.erase(0, job->consumed);
+
+    VALUE chunk = rb_funcall(job->input, rb_intern("read"), 2, SIZET2NUM(STREAM_CHUNK_SIZE), job->read_buffer);
+
+    if (NIL_P(chunk)) {
+      job->final = true;
+    } else {
+      StringValue(chunk);
+      job->pending.append(RSTRING_PTR(chunk), RSTRING_LEN(chunk));
+      job->bytes_read += RSTRING_LEN(chunk);
+    }
+
+    job->data = job->pending.data();
+    job->len = job->pending.size();
+  }
+
+  job->consumed = 0;
+
+  return true;
+}
+
+static VALUE stream_job_run(VALUE data) {
+  StreamJob *job = reinterpret_cast<StreamJob *>(data);
+  auto started_at = std::chrono::steady_clock::now();
+
+  if (!NIL_P(job->path) && !stream_job_map(job, job->path)) {
+    // Kept alive by `opened` (on the caller's stack) until it's closed.
+    // Registering its address instead would touch global GC state, which
+    // isn't safe from a Ractor.
+    job->input = rb_file_open_str(job->path, "rb");
+    rb_ary_push(job->opened, job->input);
+    job->close_input = true;
+  }
+
+  while (stream_job_fill(job)) {
+    // Same interrupt handling as the batch API, see `batch_job_run`
+    while (true) {
+      rb_thread_call_without_gvl(stream_job_without_gvl, job, stream_job_unblock, job);
+
+      if (!job->interrupted.load(std::memory_order_relaxed)) {
+        break;
+      }
+
+      rb_thread_check_ints();
+      job->interrupted.store(false, std::memory_order_relaxed);
+    }
+
+    if (job->out.size() >= STREAM_CHUNK_SIZE || job->final) {
+      stream_job_flush(job);
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+  size_t rows = job->normalizer.rows;
+  VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("rows")), SIZET2NUM(rows));
+  rb_hash_aset(result, ID2SYM(rb_intern("normalized")), SIZET2NUM(job->normalizer.normalized));
+  rb_hash_aset(result, ID2SYM(rb_intern("failed")), SIZET2NUM(job->normalizer.failed));
+  rb_hash_aset(result, ID2SYM(rb_intern("bytes_read")), SIZET2NUM(job->bytes_read));
+  rb_hash_aset(result, ID2SYM(rb_intern("bytes_written")), SIZET2NUM(job->bytes_written));
+  rb_hash_aset(result, ID2SYM(rb_intern("seconds")), DBL2NUM(seconds));
+  rb_hash_aset(result, ID2SYM(rb_intern("rows_per_sec")), DBL2NUM(seconds > 0 ? rows / seconds : 0.0));
+
+  return result;
+}
+
+static ID normalize_stream_kwarg_ids[5];
+
+extern "C" VALUE rb_normalize_stream(int argc, VALUE *argv, VALUE self) {
+  VALUE input;
+  VALUE output;
+  VALUE opts;
+  VALUE kwargs[5];
+
+  rb_scan_args(argc, argv, "2:", &input, &output, &opts);
+
+  rb_get_kwargs(opts, normalize_stream_kwarg_ids, 0, 5, kwargs);
+
+  long column = kwargs[0] == Qundef ? 0 : NUM2LONG(kwargs[0]);
+  VALUE input_region_code = kwargs[1] == Qundef ? Qnil : region_code_value(kwargs[1]);
+  NumberFormatStyle style = number_format_style_value(kwargs[2] == Qundef ? Qnil : kwargs[2]);
+  VALUE separator = kwargs[3] == Qundef ? Qnil : kwargs[3];
+
+  if (column < 0) {
+    rb_raise(rb_eArgError, "column must not be negative");
+  }
+
+  if (!NIL_P(separator)) {
+    Check_Type(separator, T_STRING);
+
+    if (RSTRING_LEN(separator) != 1) {
+      rb_raise(rb_eArgError, "separator must be a single byte");
+    }
+  }
+
+  if (NIL_P(input_region_code)) {
+    input_region_code = default_country();
+  }
+
+  if (!rb_respond_to(output, rb_intern("write"))) {
+    rb_raise(rb_eTypeError, "output must respond to #write");
+  }
+
+  // Anything which can't be read from is a path, mapped or opened by the job
+  VALUE path = rb_respond_to(input, rb_intern("read")) ? Qnil : rb_get_path(input);
+  VALUE read_buffer = rb_str_buf_new(STREAM_CHUNK_SIZE);
+  VALUE opened = rb_ary_new_capa(1);
+  StreamJob *job = new StreamJob();
+  job->normalizer.column = static_cast<size_t>(column);
+  job->normalizer.separator = NIL_P(separator) ? ',' : RSTRING_PTR(separator)[0];
+  job->normalizer.headers = kwargs[4] != Qundef && RTEST(kwargs[4]);
+  job->normalizer.region_code.assign(RSTRING_PTR(input_region_code), RSTRING_LEN(input_region_code));
+  job->normalizer.style = style;
+  job->input = NIL_P(path) ? input : Qnil;
+  job->output = output;
+  job->path = path;
+  job->read_buffer = read_buffer;
+  job->opened = opened;
+
+  VALUE result = rb_ensure(stream_job_run, reinterpret_cast<VALUE>(job), stream_job_free, reinterpret_cast<VALUE>(job));
+
+  RB_GC_GUARD(path);
+  RB_GC_GUARD(read_buffer);
+  RB_GC_GUARD(opened);
+
+  return result;
+}
+
+// Warmup
+//
+// libphonenumber compiles its regexes lazily, per region, and the format
+// table is built on first use, so the first numbers of each region are a lot
+// slower than the rest. Warming up runs every code path for the example
+// numbers of the given regions ahead of time. Done before forking, the warmed
+// up caches are shared copy-on-write with the workers.
+
+static void warmup_number(const PhoneNumberUtil &phone_util, const PhoneNumber &example,
+                          const std::string &region_code) {
+  std::string formatted;
   PhoneNumber parsed_number;
 
-  TypedData_Get_Struct(self, PhoneNumberInfo, &phone_number_info_type, phone_number_info);
+  for (int style = NUMBER_FORMAT_E164; style <= NUMBER_FORMAT_DASHERIZED_INTERNATIONAL; style++) {
+    number_format(example, static_cast<NumberFormatStyle>(style), &formatted);
+  }
 
-  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  phone_util.Format(example, PhoneNumberUtil::NATIONAL, &formatted);
+  phone_util.ParseAndKeepRawInput(formatted, region_code, &parsed_number);
+  phone_util.Format(example, PhoneNumberUtil::INTERNATIONAL, &formatted);
+  phone_util.ParseAndKeepRawInput(formatted, region_code, &parsed_number);
+
+  is_number_valid_for_region(phone_util, parsed_number, region_code);
+  phone_util.IsPossibleNumber(parsed_number);
+  phone_util.GetNumberType(parsed_number);
+  phone_util.GetLengthOfGeographicalAreaCode(parsed_number);
+}
 
-  std::string phone_number(RSTRING_PTR(str), RSTRING_LEN(str));
-  std::string country_code(RSTRING_PTR(input_region_code), RSTRING_LEN(input_region_code));
+static void warmup_one(BatchJob *job, const PhoneNumberUtil &phone_util, size_t i) {
+  const std::string &region_code = job->numbers[i];
+  PhoneNumber example;
 
-  auto result = phone_util.ParseAndKeepRawInput(phone_number, country_code, &parsed_number);
+  if (region_code == "001") {
+    std::set<int> calling_codes;
+    phone_util.GetSupportedGlobalNetworkCallingCodes(&calling_codes);
 
-  if (result != PhoneNumberUtil::NO_PARSING_ERROR) {
-    rb_phone_number_nullify_ivars(self);
+    for (int calling_code : calling_codes) {
+      if (phone_util.GetExampleNumberForNonGeoEntity(calling_code, &example)) {
+        warmup_number(phone_util, example, region_code);
+      }
+    }
+
+    return;
   }
 
-  phone_number_info->phone_number->Swap(&parsed_number);
+  if (phone_util.GetExampleNumber(region_code, &example)) {
+    warmup_number(phone_util, example, region_code);
+  }
 
-  return self;
+  if (phone_util.GetExampleNumberForType(region_code, PhoneNumberUtil::MOBILE, &example)) {
+    warmup_number(phone_util, example, region_code);
+  }
+}
+
+static VALUE warmup(VALUE data) {
+  BatchJob *job = reinterpret_cast<BatchJob *>(data);
+  auto started_at = std::chrono::steady_clock::now();
+
+  if (NIL_P(job->input_array)) {
+    // Only the allowed regions when restricted, the others are never validated
+    const RegionRestriction *restriction = region_codes_restriction();
+
+    for (size_t i = 0; i < region_code_count(); i++) {
+      if (region_code_at(i) != region_code_unknown() && region_code_allowed(restriction, region_code_at(i))) {
+        job->numbers.push_back(region_code_at(i)->code);
+      }
+    }
+  } else {
+    Check_Type(job->input_array, T_ARRAY);
+
+    for (long i = 0; i < RARRAY_LEN(job->input_array); i++) {
+      VALUE code = region_code_value(RARRAY_AREF(job->input_array, i));
+      const RegionCode *region = region_code_lookup(RSTRING_PTR(code), RSTRING_LEN(code));
+
+      if (region == NULL || region == region_code_unknown()) {
+        rb_raise(rb_eArgError, "unknown region code: %" PRIsVALUE, code);
+      }
+
+      job->numbers.push_back(region->code);
+    }
+  }
+
+  job->skipped.resize(job->numbers.size(), 0);
+  number_format_setup();
+  batch_job_run(job, warmup_one);
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+  VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("regions")), SIZET2NUM(job->numbers.size()));
+  rb_hash_aset(result, ID2SYM(rb_intern("seconds")), DBL2NUM(seconds));
+
+  return result;
+}
+
+static VALUE warmup_regions(VALUE regions, size_t threads) {
+  BatchJob *job = new BatchJob();
+  job->input_array = regions;
+  job->input_region_code = Qnil;
+  job->threads = threads;
+
+  return rb_ensure(warmup, reinterpret_cast<VALUE>(job), batch_job_free, reinterpret_cast<VALUE>(job));
+}
+
+static ID warmup_kwarg_ids[2];
+
+extern "C" VALUE rb_warmup(int argc, VALUE *argv, VALUE self) {
+  VALUE opts;
+  VALUE kwargs[2];
+
+  rb_scan_args(argc, argv, "0:", &opts);
+
+  rb_get_kwargs(opts, warmup_kwarg_ids, 0, 2, kwargs);
+
+  return warmup_regions(kwargs[0] == Qundef ? Qnil : kwargs[0], batch_job_threads_value(kwargs[1]));
+}
+
+// Splits a list of region codes from the environment ("US,GB" or "US GB")
+static VALUE env_region_codes(const char *env) {
+  VALUE regions = rb_ary_new();
+  const char *start = env;
+
+  while (true) {
+    const char *end = start + strcspn(start, ", ");
+
+    if (end > start) {
+      rb_ary_push(regions, rb_str_new(start, end - start));
+    }
+
+    if (*end == '\0') {
+      break;
+    }
+
+    start = end + 1;
+  }
+
+  return regions;
+}
+
+// MINI_PHONE_WARMUP=1 warms up every region when the extension is loaded,
+// MINI_PHONE_WARMUP=US,GB only the listed ones.
+static void warmup_from_env() {
+  const char *env = getenv("MINI_PHONE_WARMUP");
+  size_t threads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), WORKER_POOL_MAX_THREADS));
+
+  if (env == NULL || *env == '\0' || strcmp(env, "0") == 0) {
+    return;
+  }
+
+  if (strcmp(env, "1") == 0 || strcmp(env, "all") == 0) {
+    warmup_regions(Qnil, threads);
+    return;
+  }
+
+  warmup_regions(env_region_codes(env), threads);
+}
+
+// Restricting regions
+
+static inline VALUE region_restriction_report_hash() {
+  RegionRestrictionReport report = region_codes_restriction_report();
+  VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("regions")), SIZET2NUM(report.regions));
+  rb_hash_aset(result, ID2SYM(rb_intern("country_codes")), SIZET2NUM(report.country_codes));
+  rb_hash_aset(result, ID2SYM(rb_intern("metadata_bytes")), SIZET2NUM(report.metadata_bytes));
+  rb_hash_aset(result, ID2SYM(rb_intern("excluded_metadata_bytes")), SIZET2NUM(report.excluded_metadata_bytes));
+
+  return result;
+}
+
+extern "C" VALUE rb_restrict_regions(VALUE self, VALUE regions) {
+  std::vector<const RegionCode *> allowed;
+
+  if (!NIL_P(regions)) {
+    Check_Type(regions, T_ARRAY);
+
+    if (RARRAY_LEN(regions) == 0) {
+      rb_raise(rb_eArgError, "at least one region is required, pass nil to lift the restriction");
+    }
+
+    for (long i = 0; i < RARRAY_LEN(regions); i++) {
+      VALUE code = region_code_value(RARRAY_AREF(regions, i));
+      const RegionCode *region = region_code_lookup(RSTRING_PTR(code), RSTRING_LEN(code));
+
+      if (region == NULL || region == region_code_unknown()) {
+        rb_raise(rb_eArgError, "unknown region code: %" PRIsVALUE, code);
+      }
+
+      allowed.push_back(region);
+    }
+  }
+
+  region_codes_restrict(allowed);
+
+  // Cached validity was decided under the previous restriction
+  parse_cache_clear();
+
+  return region_restriction_report_hash();
+}
+
+extern "C" VALUE rb_restricted_regions(VALUE self) {
+  std::vector<const RegionCode *> allowed = region_codes_allowed();
+
+  if (allowed.empty()) {
+    return Qnil;
+  }
+
+  VALUE result = rb_ary_new_capa(static_cast<long>(allowed.size()));
+
+  for (const RegionCode *region : allowed) {
+    rb_ary_push(result, region_code_string(region));
+  }
+
+  return rb_ary_freeze(result);
+}
+
+extern "C" VALUE rb_region_restriction_report(VALUE self) { return region_restriction_report_hash(); }
+
+// Prefix data
+
+static VALUE prefix_data_info_hash() {
+  if (!prefix_data_loaded()) {
+    return Qnil;
+  }
+
+  PrefixDataInfo info = prefix_data_info();
+  VALUE result = rb_hash_new();
+  VALUE carrier = rb_ary_new();
+  VALUE geocoding = rb_ary_new();
+
+  for (const std::string &locale : info.locales[PREFIX_DATA_CARRIER]) {
+    rb_ary_push(carrier, rb_str_new(locale.data(), locale.size()));
+  }
+
+  for (const std::string &locale : info.locales[PREFIX_DATA_GEOCODING]) {
+    rb_ary_push(geocoding, rb_str_new(locale.data(), locale.size()));
+  }
+
+  rb_hash_aset(result, ID2SYM(rb_intern("bytes")), SIZET2NUM(info.bytes));
+  rb_hash_aset(result, ID2SYM(rb_intern("carrier")), carrier);
+  rb_hash_aset(result, ID2SYM(rb_intern("geocoding")), geocoding);
+
+  return result;
+}
+
+extern "C" VALUE rb_load_prefix_data(VALUE self, VALUE path) {
+  path = rb_get_path(path);
+  VALUE message = Qnil;
+
+  {
+    std::string error;
+
+    if (!prefix_data_open(RSTRING_PTR(path), &error)) {
+      message = rb_str_new(error.data(), error.size());
+    }
+  }
+
+  if (!NIL_P(message)) {
+    rb_raise(rb_eIOError, "can't load prefix data from %" PRIsVALUE ": %" PRIsVALUE, path, message);
+  }
+
+  return prefix_data_info_hash();
+}
+
+extern "C" VALUE rb_prefix_data(VALUE self) { return prefix_data_info_hash(); }
+
+// MINI_PHONE_PREFIX_DATA=path/to/prefix_data.bin loads the prefix data when
+// the extension is loaded
+static void prefix_data_from_env() {
+  const char *env = getenv("MINI_PHONE_PREFIX_DATA");
+
+  if (env == NULL || *env == '\0') {
+    return;
+  }
+
+  rb_load_prefix_data(Qnil, rb_str_new_cstr(env));
+}
+
+// MINI_PHONE_REGIONS=US,CA restricts the regions when the extension is loaded
+static void restrict_regions_from_env() {
+  const char *env = getenv("MINI_PHONE_REGIONS");
+
+  if (env == NULL || *env == '\0') {
+    return;
+  }
+
+  rb_restrict_regions(Qnil, env_region_codes(env));
+}
+
+extern "C" VALUE rb_set_cache_size(VALUE self, VALUE size) {
+  long capacity = NUM2LONG(size);
+
+  if (capacity < 0) {
+    rb_raise(rb_eArgError, "cache size must not be negative");
+  }
+
+  parse_cache_set_capacity(static_cast<size_t>(capacity));
+
+  return size;
+}
+
+extern "C" VALUE rb_get_cache_size(VALUE self) { return SIZET2NUM(parse_cache_stats().capacity); }
+
+extern "C" VALUE rb_cache_stats(VALUE self) {
+  ParseCacheStats stats = parse_cache_stats();
+  VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("hits")), SIZET2NUM(stats.hits));
+  rb_hash_aset(result, ID2SYM(rb_intern("misses")), SIZET2NUM(stats.misses));
+  rb_hash_aset(result, ID2SYM(rb_intern("evictions")), SIZET2NUM(stats.evictions));
+  rb_hash_aset(result, ID2SYM(rb_intern("size")), SIZET2NUM(stats.size));
+  rb_hash_aset(result, ID2SYM(rb_intern("capacity")), SIZET2NUM(stats.capacity));
+
+  return result;
+}
+
+extern "C" VALUE rb_clear_cache(VALUE self) {
+  parse_cache_clear();
+
+  return Qnil;
+}
+
+static inline VALUE stats_counters_hash(StatsCounters counters) {
+  VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("calls")), ULL2NUM(counters.calls));
+  rb_hash_aset(result, ID2SYM(rb_intern("ns")), ULL2NUM(counters.ns));
+
+  return result;
+}
+
+extern "C" VALUE rb_stats(VALUE self) {
+  VALUE result = rb_hash_new();
+  VALUE phases = rb_hash_new();
+  VALUE regions = rb_hash_new();
+
+  for (int i = 0; i < STATS_PHASE_COUNT; i++) {
+    StatsPhase phase = static_cast<StatsPhase>(i);
+    rb_hash_aset(phases, ID2SYM(rb_intern(stats_phase_name(phase))), stats_counters_hash(stats_phase(phase)));
+  }
+
+  for (size_t i = 0; i < region_code_count(); i++) {
+    StatsCounters counters = stats_region(i);
+
+    if (counters.calls > 0) {
+      rb_hash_aset(regions, region_code_string(region_code_at(i)), stats_counters_hash(counters));
+    }
+  }
+
+  rb_hash_aset(result, ID2SYM(rb_intern("enabled")), stats_enabled() ? Qtrue : Qfalse);
+  rb_hash_aset(result, ID2SYM(rb_intern("phases")), phases);
+  rb_hash_aset(result, ID2SYM(rb_intern("regions")), regions);
+
+  return result;
+}
+
+extern "C" VALUE rb_reset_stats(VALUE self) {
+  stats_reset();
+
+  return Qnil;
+}
+
+extern "C" VALUE rb_set_stats_enabled(VALUE self, VALUE enabled) {
+  stats_set_enabled(RTEST(enabled));
+
+  return enabled;
+}
+
+extern "C" VALUE rb_is_stats_enabled(VALUE self) { return stats_enabled() ? Qtrue : Qfalse; }
+
+extern "C" VALUE rb_phone_number_pool_stats(VALUE self) {
+  std::lock_guard<std::mutex> guard(phone_number_pool_mutex);
+  VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("allocated")), SIZET2NUM(phone_number_pool_allocated));
+  rb_hash_aset(result, ID2SYM(rb_intern("recycled")), SIZET2NUM(phone_number_pool_recycled));
+  rb_hash_aset(result, ID2SYM(rb_intern("pooled")), SIZET2NUM(phone_number_pool.size()));
+  rb_hash_aset(result, ID2SYM(rb_intern("capacity")), SIZET2NUM(phone_number_pool_capacity));
+
+  return result;
+}
+
+extern "C" VALUE rb_phone_number_set_pool_size(VALUE self, VALUE size) {
+  long capacity = NUM2LONG(size);
+
+  if (capacity < 0) {
+    rb_raise(rb_eArgError, "pool size must not be negative");
+  }
+
+  std::vector<PhoneNumberInfo *> released;
+
+  {
+    std::lock_guard<std::mutex> guard(phone_number_pool_mutex);
+    phone_number_pool_capacity = static_cast<size_t>(capacity);
+
+    while (phone_number_pool.size() > phone_number_pool_capacity) {
+      released.push_back(phone_number_pool.back());
+      phone_number_pool.pop_back();
+    }
+
+    phone_number_pool.reserve(phone_number_pool_capacity);
+  }
+
+  for (PhoneNumberInfo *phone_number_info : released) {
+    phone_number_info->~PhoneNumberInfo();
+    xfree(phone_number_info);
+  }
+
+  return size;
+}
+
+// Every keyword and symbol the extension looks up, interned once at load
+// time rather than lazily, which would race between Ractors
+static void setup_ids() {
+  id_default_country = rb_intern("__mini_phone_default_country__");
+  normalize_kwarg_ids[0] = rb_intern("format");
+  to_packed_kwarg_ids[0] = rb_intern("raw_input");
+  threads_kwarg_ids[0] = rb_intern("threads");
+  batch_column_ids[0] = rb_intern("parsed");
+  batch_column_ids[1] = rb_intern("valid");
+  batch_column_ids[2] = rb_intern("country_code");
+  batch_column_ids[3] = rb_intern("type");
+  parse_columns_kwarg_ids[0] = rb_intern("fields");
+  parse_columns_kwarg_ids[1] = rb_intern("threads");
+  match_ids[0] = rb_intern("short_nsn_match");
+  match_ids[1] = rb_intern("nsn_match");
+  match_ids[2] = rb_intern("exact_match");
+  leniency_ids[0] = rb_intern("possible");
+  leniency_ids[1] = rb_intern("valid");
+  leniency_ids[2] = rb_intern("strict_grouping");
+  leniency_ids[3] = rb_intern("exact_grouping");
+  find_numbers_kwarg_ids[0] = rb_intern("leniency");
+  find_numbers_kwarg_ids[1] = rb_intern("threads");
+  normalize_stream_kwarg_ids[0] = rb_intern("column");
+  normalize_stream_kwarg_ids[1] = rb_intern("country");
+  normalize_stream_kwarg_ids[2] = rb_intern("format");
+  normalize_stream_kwarg_ids[3] = rb_intern("separator");
+  normalize_stream_kwarg_ids[4] = rb_intern("headers");
+  warmup_kwarg_ids[0] = rb_intern("regions");
+  warmup_kwarg_ids[1] = rb_intern("threads");
 }
 
 extern "C" void Init_mini_phone(void) {
-  setup_formats();
+#ifdef HAVE_RB_EXT_RACTOR_SAFE
+  rb_ext_ractor_safe(true);
+#endif
+
+  phone_number_pool.reserve(phone_number_pool_capacity);
 
   rb_mMiniPhone = rb_define_module("MiniPhone");
 
+  setup_region_codes();
+  setup_ids();
+
+  // So an app can be profiled without code changes
+  const char *stats_env = getenv("MINI_PHONE_STATS");
+  stats_set_enabled(stats_env != NULL && *stats_env != '\0' && strcmp(stats_env, "0") != 0);
+
   // Unknown
-  rb_iv_set(rb_mMiniPhone, "@default_country", rb_str_new("ZZ", 2));
+  default_country_code.store(region_code_string(region_code_unknown()), std::memory_order_relaxed);
+  rb_gc_register_mark_object(TypedData_Wrap_Struct(0, &default_country_holder_type, &default_country_code));
 
   rb_define_module_function(rb_mMiniPhone, "valid?", reinterpret_cast<VALUE (*)(...)>(rb_is_phone_number_valid), 1);
   rb_define_module_function(rb_mMiniPhone, "valid_for_country?",
@@ -558,14 +3326,60 @@ extern "C" void Init_mini_phone(void) {
                             1);
   rb_define_module_function(rb_mMiniPhone, "default_country", reinterpret_cast<VALUE (*)(...)>(rb_get_default_country),
                             0);
+  rb_define_module_function(rb_mMiniPhone, "with_default_country",
+                            reinterpret_cast<VALUE (*)(...)>(rb_with_default_country), 1);
   rb_define_module_function(rb_mMiniPhone, "parse", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_parse), -1);
   rb_define_module_function(rb_mMiniPhone, "normalize_digits_only",
-                            reinterpret_cast<VALUE (*)(...)>(rb_normalize_digits_only), 1);
+                            reinterpret_cast<VALUE (*)(...)>(rb_normalize_digits_only), -1);
+  rb_define_module_function(rb_mMiniPhone, "e164", reinterpret_cast<VALUE (*)(...)>(rb_one_shot_e164), -1);
+  rb_define_module_function(rb_mMiniPhone, "normalize", reinterpret_cast<VALUE (*)(...)>(rb_one_shot_normalize), -1);
+  rb_define_module_function(rb_mMiniPhone, "type", reinterpret_cast<VALUE (*)(...)>(rb_one_shot_type), -1);
+  rb_define_module_function(rb_mMiniPhone, "valid_many?",
+                            reinterpret_cast<VALUE (*)(...)>(rb_is_phone_number_valid_many), -1);
+  rb_define_module_function(rb_mMiniPhone, "parse_many", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_parse_many),
+                            -1);
+  rb_define_module_function(rb_mMiniPhone, "parse_columns",
+                            reinterpret_cast<VALUE (*)(...)>(rb_phone_number_parse_columns), -1);
+  rb_define_module_function(rb_mMiniPhone, "e164_many",
+                            reinterpret_cast<VALUE (*)(...)>(rb_phone_number_e164_many), -1);
+  rb_define_module_function(rb_mMiniPhone, "normalize_digits_many",
+                            reinterpret_cast<VALUE (*)(...)>(rb_normalize_digits_many), -1);
+  rb_define_module_function(rb_mMiniPhone, "find_numbers", reinterpret_cast<VALUE (*)(...)>(rb_find_numbers), -1);
+  rb_define_module_function(rb_mMiniPhone, "find_numbers_many", reinterpret_cast<VALUE (*)(...)>(rb_find_numbers_many),
+                            -1);
+  rb_define_module_function(rb_mMiniPhone, "normalize_stream", reinterpret_cast<VALUE (*)(...)>(rb_normalize_stream),
+                            -1);
+  rb_define_module_function(rb_mMiniPhone, "cache_size=", reinterpret_cast<VALUE (*)(...)>(rb_set_cache_size), 1);
+  rb_define_module_function(rb_mMiniPhone, "cache_size", reinterpret_cast<VALUE (*)(...)>(rb_get_cache_size), 0);
+  rb_define_module_function(rb_mMiniPhone, "cache_stats", reinterpret_cast<VALUE (*)(...)>(rb_cache_stats), 0);
+  rb_define_module_function(rb_mMiniPhone, "clear_cache", reinterpret_cast<VALUE (*)(...)>(rb_clear_cache), 0);
+  rb_define_module_function(rb_mMiniPhone, "warmup!", reinterpret_cast<VALUE (*)(...)>(rb_warmup), -1);
+  rb_define_module_function(rb_mMiniPhone, "restrict_regions", reinterpret_cast<VALUE (*)(...)>(rb_restrict_regions),
+                            1);
+  rb_define_module_function(rb_mMiniPhone, "restricted_regions",
+                            reinterpret_cast<VALUE (*)(...)>(rb_restricted_regions), 0);
+  rb_define_module_function(rb_mMiniPhone, "region_restriction_report",
+                            reinterpret_cast<VALUE (*)(...)>(rb_region_restriction_report), 0);
+  rb_define_module_function(rb_mMiniPhone, "load_prefix_data", reinterpret_cast<VALUE (*)(...)>(rb_load_prefix_data),
+                            1);
+  rb_define_module_function(rb_mMiniPhone, "prefix_data", reinterpret_cast<VALUE (*)(...)>(rb_prefix_data), 0);
+  rb_define_module_function(rb_mMiniPhone, "stats", reinterpret_cast<VALUE (*)(...)>(rb_stats), 0);
+  rb_define_module_function(rb_mMiniPhone, "reset_stats", reinterpret_cast<VALUE (*)(...)>(rb_reset_stats), 0);
+  rb_define_module_function(rb_mMiniPhone, "stats_enabled=", reinterpret_cast<VALUE (*)(...)>(rb_set_stats_enabled),
+                            1);
+  rb_define_module_function(rb_mMiniPhone, "stats_enabled?", reinterpret_cast<VALUE (*)(...)>(rb_is_stats_enabled),
+                            0);
 
   rb_cPhoneNumber = rb_define_class_under(rb_mMiniPhone, "PhoneNumber", rb_cObject);
 
   rb_define_singleton_method(rb_cPhoneNumber, "parse", reinterpret_cast<VALUE (*)(...)>(rb_class_new_instance), -1);
   rb_define_alloc_func(rb_cPhoneNumber, rb_phone_number_alloc);
+  rb_define_singleton_method(rb_cPhoneNumber, "from_packed",
+                             reinterpret_cast<VALUE (*)(...)>(rb_phone_number_from_packed), -1);
+  rb_define_singleton_method(rb_cPhoneNumber, "pool_stats",
+                             reinterpret_cast<VALUE (*)(...)>(rb_phone_number_pool_stats), 0);
+  rb_define_singleton_method(rb_cPhoneNumber, "pool_size=",
+                             reinterpret_cast<VALUE (*)(...)>(rb_phone_number_set_pool_size), 1);
   rb_define_method(rb_cPhoneNumber, "initialize", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_initialize), -1);
   rb_define_method(rb_cPhoneNumber, "valid?", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_valid_eh), 0);
   rb_define_method(rb_cPhoneNumber, "invalid?", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_invalid_eh), 0);
@@ -589,6 +3403,57 @@ extern "C" void Init_mini_phone(void) {
   rb_define_method(rb_cPhoneNumber, "country_code", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_country_code), 0);
   rb_define_method(rb_cPhoneNumber, "type", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_type), 0);
   rb_define_method(rb_cPhoneNumber, "area_code", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_area_code), 0);
+  rb_define_method(rb_cPhoneNumber, "carrier", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_carrier), -1);
+  rb_define_method(rb_cPhoneNumber, "location", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_location), -1);
   rb_define_method(rb_cPhoneNumber, "to_s", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_to_s), 0);
+  rb_define_method(rb_cPhoneNumber, "to_packed", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_to_packed), -1);
+  rb_define_method(rb_cPhoneNumber, "to_packed_int", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_to_packed_int),
+                   0);
   rb_define_method(rb_cPhoneNumber, "==", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_match_eh), 1);
+  rb_define_method(rb_cPhoneNumber, "eql?", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_eql_eh), 1);
+  rb_define_method(rb_cPhoneNumber, "hash", reinterpret_cast<VALUE (*)(...)>(rb_phone_number_hash), 0);
+
+  // The type codes of MiniPhone.parse_columns
+  VALUE types = rb_ary_new();
+
+  for (int type = PhoneNumberUtil::FIXED_LINE; type <= PhoneNumberUtil::UNKNOWN; type++) {
+    rb_ary_push(types, phone_number_type_symbol(static_cast<PhoneNumberUtil::PhoneNumberType>(type)));
+  }
+
+  rb_define_const(rb_mMiniPhone, "TYPES", rb_ary_freeze(types));
+
+  rb_cNumberMatch =
+      rb_struct_define_under(rb_mMiniPhone, "NumberMatch", "start", "end", "raw_string", "phone_number", NULL);
+
+  rb_cMatcher = rb_define_class_under(rb_mMiniPhone, "Matcher", rb_cObject);
+
+  rb_define_alloc_func(rb_cMatcher, rb_matcher_alloc);
+  rb_define_method(rb_cMatcher, "initialize", reinterpret_cast<VALUE (*)(...)>(rb_matcher_initialize), -1);
+  rb_define_method(rb_cMatcher, "match", reinterpret_cast<VALUE (*)(...)>(rb_matcher_match), -1);
+  rb_define_method(rb_cMatcher, "size", reinterpret_cast<VALUE (*)(...)>(rb_matcher_size), 0);
+
+  rb_cAsYouType = rb_define_class_under(rb_mMiniPhone, "AsYouType", rb_cObject);
+
+  rb_define_alloc_func(rb_cAsYouType, rb_as_you_type_alloc);
+  rb_define_method(rb_cAsYouType, "initialize", reinterpret_cast<VALUE (*)(...)>(rb_as_you_type_initialize), -1);
+  rb_define_method(rb_cAsYouType, "input_digit", reinterpret_cast<VALUE (*)(...)>(rb_as_you_type_input_digit), 1);
+  rb_define_method(rb_cAsYouType, "input", reinterpret_cast<VALUE (*)(...)>(rb_as_you_type_input), 1);
+  rb_define_method(rb_cAsYouType, "remove_last", reinterpret_cast<VALUE (*)(...)>(rb_as_you_type_remove_last), 0);
+  rb_define_method(rb_cAsYouType, "clear", reinterpret_cast<VALUE (*)(...)>(rb_as_you_type_clear), 0);
+  rb_define_method(rb_cAsYouType, "to_s", reinterpret_cast<VALUE (*)(...)>(rb_as_you_type_to_s), 0);
+
+  rb_cNumberSet = rb_define_class_under(rb_mMiniPhone, "NumberSet", rb_cObject);
+
+  rb_define_alloc_func(rb_cNumberSet, rb_number_set_alloc);
+  rb_define_method(rb_cNumberSet, "initialize", reinterpret_cast<VALUE (*)(...)>(rb_number_set_initialize), -1);
+  rb_define_method(rb_cNumberSet, "add", reinterpret_cast<VALUE (*)(...)>(rb_number_set_add), 1);
+  rb_define_method(rb_cNumberSet, "add_all", reinterpret_cast<VALUE (*)(...)>(rb_number_set_add_all), -1);
+  rb_define_method(rb_cNumberSet, "include?", reinterpret_cast<VALUE (*)(...)>(rb_number_set_include_eh), 1);
+  rb_define_method(rb_cNumberSet, "size", reinterpret_cast<VALUE (*)(...)>(rb_number_set_size), 0);
+  rb_define_method(rb_cNumberSet, "length", reinterpret_cast<VALUE (*)(...)>(rb_number_set_size), 0);
+  rb_define_method(rb_cNumberSet, "clear", reinterpret_cast<VALUE (*)(...)>(rb_number_set_clear), 0);
+
+  restrict_regions_from_env();
+  prefix_data_from_env();
+  warmup_from_env();
 }
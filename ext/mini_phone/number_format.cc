@@ -0,0 +1,396 @@
+#include "number_format.h"
+#include "compiled_metadata.h"
+#include "digit_pattern.h"
+#include "phonenumbers/phonemetadata.pb.h"
+#include "phonenumbers/phonenumberutil.h"
+#include "region_codes.h"
+#include "stats.h"
+#include <cstring>
+#include <vector>
+
+using namespace ::i18n::phonenumbers;
+using google::protobuf::RepeatedPtrField;
+
+// A national format from the metadata, compiled so the digit groups of a
+// national significant number can be sliced out directly.
+struct CompiledFormat {
+  DigitGroupsPattern pattern;
+  DigitPrefixPattern leading_digits;
+  bool has_leading_digits;
+  // The groups referenced by the format ("$1 $2-$3"), in order
+  std::vector<int> groups;
+};
+
+struct CountryFormats {
+  std::vector<CompiledFormat> formats;
+  std::string extension_prefix;
+  // When one of the patterns is outside of what the digit matchers support,
+  // the country is formatted by libphonenumber with these instead (the same
+  // formats with "-" between the groups). Empty for the other countries.
+  bool fallback;
+  RepeatedPtrField<NumberFormat> dasherized;
+};
+
+// The groups a format references, in order ("$1 $2-$3" gives 0, 1, 2)
+static void format_groups(const std::string &format, std::vector<int> *groups) {
+  for (size_t i = 0; i + 1 < format.size(); i++) {
+    if (format[i] == '$' && format[i + 1] >= '1' && format[i + 1] <= '9') {
+      groups->push_back(format[i + 1] - '1');
+    }
+  }
+}
+
+static bool compile_format(const NumberFormat &number_format, CompiledFormat *compiled) {
+  if (!compiled->pattern.compile(number_format.pattern())) {
+    return false;
+  }
+
+  int count = number_format.leading_digits_pattern_size();
+  compiled->has_leading_digits = count > 0;
+
+  // Like libphonenumber, only the last (most specific) pattern is used
+  if (compiled->has_leading_digits &&
+      !compiled->leading_digits.compile(number_format.leading_digits_pattern(count - 1))) {
+    return false;
+  }
+
+  format_groups(number_format.format(), &compiled->groups);
+
+  for (int group : compiled->groups) {
+    if (static_cast<size_t>(group) >= compiled->pattern.group_count()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// The formats libphonenumber is given for a country instead of the compiled
+// ones: the same patterns, with "-" between the groups. Only what
+// FormatByPattern looks at is copied.
+static void dasherize_formats(const PhoneMetadata &metadata, RepeatedPtrField<NumberFormat> *dasherized) {
+  for (const NumberFormat &number_format : metadata.number_format()) {
+    NumberFormat *copy = dasherized->Add();
+    int count = number_format.leading_digits_pattern_size();
+    std::vector<int> groups;
+    std::string format;
+
+    copy->set_pattern(number_format.pattern());
+
+    if (count > 0) {
+      copy->add_leading_digits_pattern(number_format.leading_digits_pattern(count - 1));
+    }
+
+    format_groups(number_format.format(), &groups);
+
+    for (int group : groups) {
+      format.append(format.empty() ? "$" : "-$");
+      format.push_back(static_cast<char>('1' + group));
+    }
+
+    copy->set_format(format);
+  }
+}
+
+static CountryFormats *compile_country_formats(const PhoneMetadata &metadata) {
+  CountryFormats *country = new CountryFormats();
+  country->fallback = false;
+  country->extension_prefix = metadata.has_preferred_extn_prefix() ? metadata.preferred_extn_prefix() : " ext. ";
+
+  for (const NumberFormat &number_format : metadata.number_format()) {
+    CompiledFormat compiled;
+
+    if (!compile_format(number_format, &compiled)) {
+      country->fallback = true;
+    }
+
+    country->formats.push_back(std::move(compiled));
+  }
+
+  if (country->fallback) {
+    dasherize_formats(metadata, &country->dasherized);
+  }
+
+  return country;
+}
+
+// Set by number_format_setup(metadata), before the tables are built
+static const PhoneMetadataCollection *setup_metadata = nullptr;
+
+// The metadata of each country calling code, indexed by the code. Several
+// regions share a calling code, the main one holds the formats.
+static std::vector<const PhoneMetadata *> metadata_by_country_code(const PhoneMetadataCollection &collection) {
+  std::vector<const PhoneMetadata *> by_country_code(MAX_COUNTRY_CODE + 1, nullptr);
+
+  for (const PhoneMetadata &metadata : collection.metadata()) {
+    int country_code = metadata.country_code();
+
+    if (country_code <= 0 || country_code > MAX_COUNTRY_CODE) {
+      continue;
+    }
+
+    if (by_country_code[country_code] == nullptr || metadata.main_country_for_code()) {
+      by_country_code[country_code] = &metadata;
+    }
+  }
+
+  return by_country_code;
+}
+
+// libphonenumber's compiled in metadata, parsed into `parsed`, unless other
+// metadata was set up. NULL when it doesn't parse.
+static const PhoneMetadataCollection *load_metadata(PhoneMetadataCollection *parsed) {
+  if (setup_metadata != nullptr) {
+    return setup_metadata;
+  }
+
+  return parsed->ParseFromArray(metadata_get(), metadata_size()) ? parsed : nullptr;
+}
+
+// Built on first use from the metadata, indexed by country calling code. NULL
+// for codes libphonenumber doesn't know about. The parsed metadata is only
+// kept around for the countries that fall back to libphonenumber.
+static const std::vector<const CountryFormats *> &country_formats_table() {
+  static const std::vector<const CountryFormats *> *table = [] {
+    auto *table = new std::vector<const CountryFormats *>(MAX_COUNTRY_CODE + 1, nullptr);
+    PhoneMetadataCollection parsed;
+    const PhoneMetadataCollection *collection = load_metadata(&parsed);
+
+    if (collection == nullptr) {
+      return table;
+    }
+
+    std::vector<const PhoneMetadata *> by_country_code = metadata_by_country_code(*collection);
+
+    for (int country_code = 1; country_code <= MAX_COUNTRY_CODE; country_code++) {
+      if (by_country_code[country_code] != nullptr) {
+        (*table)[country_code] = compile_country_formats(*by_country_code[country_code]);
+      }
+    }
+
+    return table;
+  }();
+
+  return *table;
+}
+
+// The dashed formats of every country, for number_format_dasherized_reference
+// only. Built on its first call.
+static const std::vector<const RepeatedPtrField<NumberFormat> *> &dasherized_reference_table() {
+  static const std::vector<const RepeatedPtrField<NumberFormat> *> *table = [] {
+    auto *table = new std::vector<const RepeatedPtrField<NumberFormat> *>(MAX_COUNTRY_CODE + 1, nullptr);
+    PhoneMetadataCollection parsed;
+    const PhoneMetadataCollection *collection = load_metadata(&parsed);
+
+    if (collection == nullptr) {
+      return table;
+    }
+
+    std::vector<const PhoneMetadata *> by_country_code = metadata_by_country_code(*collection);
+
+    for (int country_code = 1; country_code <= MAX_COUNTRY_CODE; country_code++) {
+      if (by_country_code[country_code] != nullptr) {
+        auto *formats = new RepeatedPtrField<NumberFormat>();
+        dasherize_formats(*by_country_code[country_code], formats);
+        (*table)[country_code] = formats;
+      }
+    }
+
+    return table;
+  }();
+
+  return *table;
+}
+
+static inline const CountryFormats *country_formats(int country_code) {
+  if (country_code <= 0 || country_code > MAX_COUNTRY_CODE) {
+    return nullptr;
+  }
+
+  return country_formats_table()[country_code];
+}
+
+void number_format_setup() { country_formats_table(); }
+
+void number_format_setup(const PhoneMetadataCollection &metadata) {
+  setup_metadata = &metadata;
+  country_formats_table();
+}
+
+static inline void append_extension(const PhoneNumber &number, const CountryFormats *country, std::string *out) {
+  if (number.has_extension() && !number.extension().empty()) {
+    out->append(country->extension_prefix);
+    out->append(number.extension());
+  }
+}
+
+// What FormatByPattern(NATIONAL) gives with "$1$2$3": the national significant
+// number, with the extension of known countries.
+static void format_raw_national(const PhoneNumber &number, std::string *out) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  const CountryFormats *country = country_formats(number.country_code());
+
+  out->clear();
+  phone_util.GetNationalSignificantNumber(number, out);
+
+  if (country != nullptr) {
+    append_extension(number, country, out);
+  }
+}
+
+static inline void format_dasherized_by_pattern(const PhoneNumber &number, const CountryFormats *country,
+                                                std::string *out) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+
+  out->clear();
+  phone_util.FormatByPattern(number, PhoneNumberUtil::NATIONAL, country->dasherized, out);
+}
+
+// Picks the format like ChooseFormattingPatternForNumber does and joins its
+// groups with dashes. Numbers no format applies to are left as is.
+static void format_dasherized_national(const PhoneNumber &number, std::string *out) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  const CountryFormats *country = country_formats(number.country_code());
+
+  if (country != nullptr && country->fallback) {
+    format_dasherized_by_pattern(number, country, out);
+    return;
+  }
+
+  static thread_local std::string nsn;
+  static thread_local std::vector<int> captures;
+
+  nsn.clear();
+  out->clear();
+  phone_util.GetNationalSignificantNumber(number, &nsn);
+
+  if (country == nullptr) {
+    out->assign(nsn);
+    return;
+  }
+
+  // Can't come out of parsing, which stops at 17 digits
+  if (nsn.size() > DigitGroupsPattern::MAX_DIGITS) {
+    number_format_dasherized_reference(number, out);
+    return;
+  }
+
+  const CompiledFormat *chosen = nullptr;
+
+  for (const CompiledFormat &format : country->formats) {
+    if (format.has_leading_digits && !format.leading_digits.match_prefix(nsn)) {
+      continue;
+    }
+
+    if (format.pattern.match_full(nsn, &captures)) {
+      chosen = &format;
+      break;
+    }
+  }
+
+  if (chosen == nullptr) {
+    out->assign(nsn);
+  } else {
+    // Every group the format refers to gets its dash, empty ones too, the
+    // way FormatByPattern fills in "$1-$2-$3"
+    for (size_t i = 0; i < chosen->groups.size(); i++) {
+      int group = chosen->groups[i];
+      int begin = captures[group * 2];
+      int end = captures[group * 2 + 1];
+
+      if (i > 0) {
+        out->push_back('-');
+      }
+
+      out->append(nsn, begin, end - begin);
+    }
+  }
+
+  append_extension(number, country, out);
+}
+
+void number_format_dasherized_reference(const PhoneNumber &number, std::string *out) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  int country_code = number.country_code();
+  const RepeatedPtrField<NumberFormat> *formats = nullptr;
+
+  if (country_code > 0 && country_code <= MAX_COUNTRY_CODE) {
+    formats = dasherized_reference_table()[country_code];
+  }
+
+  out->clear();
+
+  if (formats == nullptr) {
+    phone_util.GetNationalSignificantNumber(number, out);
+  } else {
+    phone_util.FormatByPattern(number, PhoneNumberUtil::NATIONAL, *formats, out);
+  }
+}
+
+static const struct {
+  const char *name;
+  NumberFormatStyle style;
+} style_names[] = {
+    {"e164", NUMBER_FORMAT_E164},
+    {"national", NUMBER_FORMAT_NATIONAL},
+    {"international", NUMBER_FORMAT_INTERNATIONAL},
+    {"rfc3966", NUMBER_FORMAT_RFC3966},
+    {"raw_national", NUMBER_FORMAT_RAW_NATIONAL},
+    {"dasherized_national", NUMBER_FORMAT_DASHERIZED_NATIONAL},
+    {"raw_international", NUMBER_FORMAT_RAW_INTERNATIONAL},
+    {"dasherized_international", NUMBER_FORMAT_DASHERIZED_INTERNATIONAL},
+};
+
+bool number_format_style_lookup(const char *name, size_t len, NumberFormatStyle *style) {
+  for (const auto &entry : style_names) {
+    if (strlen(entry.name) == len && memcmp(entry.name, name, len) == 0) {
+      *style = entry.style;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void number_format(const PhoneNumber &number, NumberFormatStyle style, std::string *out) {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  StatsTimer timer(STATS_PHASE_FORMAT);
+
+  out->clear();
+
+  switch (style) {
+  case NUMBER_FORMAT_E164:
+    phone_util.Format(number, PhoneNumberUtil::E164, out);
+    break;
+  case NUMBER_FORMAT_NATIONAL:
+    phone_util.Format(number, PhoneNumberUtil::NATIONAL, out);
+    break;
+  case NUMBER_FORMAT_INTERNATIONAL:
+    phone_util.Format(number, PhoneNumberUtil::INTERNATIONAL, out);
+    break;
+  case NUMBER_FORMAT_RFC3966:
+    phone_util.Format(number, PhoneNumberUtil::RFC3966, out);
+    break;
+  case NUMBER_FORMAT_RAW_NATIONAL:
+    format_raw_national(number, out);
+    break;
+  case NUMBER_FORMAT_DASHERIZED_NATIONAL:
+    format_dasherized_national(number, out);
+    break;
+  case NUMBER_FORMAT_RAW_INTERNATIONAL: {
+    static thread_local std::string national;
+    format_raw_national(number, &national);
+    out->assign(std::to_string(number.country_code()));
+    out->append(national);
+    break;
+  }
+  case NUMBER_FORMAT_DASHERIZED_INTERNATIONAL: {
+    static thread_local std::string national;
+    format_dasherized_national(number, &national);
+    out->assign(std::to_string(number.country_code()));
+    out->push_back('-');
+    out->append(national);
+    break;
+  }
+  }
+}
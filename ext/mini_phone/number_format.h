@@ -0,0 +1,43 @@
+#ifndef MINI_PHONE_NUMBER_FORMAT_H
+#define MINI_PHONE_NUMBER_FORMAT_H 1
+
+#include "phonenumbers/phonemetadata.pb.h"
+#include "phonenumbers/phonenumber.pb.h"
+#include <cstddef>
+#include <string>
+
+// Every output format the PhoneNumber accessors support, shared with the
+// native bulk APIs so both produce byte for byte the same strings.
+enum NumberFormatStyle {
+  NUMBER_FORMAT_E164,
+  NUMBER_FORMAT_NATIONAL,
+  NUMBER_FORMAT_INTERNATIONAL,
+  NUMBER_FORMAT_RFC3966,
+  NUMBER_FORMAT_RAW_NATIONAL,
+  NUMBER_FORMAT_DASHERIZED_NATIONAL,
+  NUMBER_FORMAT_RAW_INTERNATIONAL,
+  NUMBER_FORMAT_DASHERIZED_INTERNATIONAL,
+};
+
+// Looks up a style by its accessor name ("e164", "raw_national", ...).
+bool number_format_style_lookup(const char *name, size_t len, NumberFormatStyle *style);
+
+// Builds the per-country format table used for the raw and dasherized styles
+// from libphonenumber's metadata. Otherwise that happens on first use.
+void number_format_setup();
+
+// Builds the table from `metadata` instead of libphonenumber's own, which
+// spec/native/format_check.cc uses to add formats the metadata doesn't have.
+// Has to come before anything is formatted, and `metadata` has to stay around.
+void number_format_setup(const i18n::phonenumbers::PhoneMetadataCollection &metadata);
+
+// Replaces the contents of `out` with the formatted number. Safe to call
+// without the GVL.
+void number_format(const i18n::phonenumbers::PhoneNumber &number, NumberFormatStyle style, std::string *out);
+
+// The dasherized national style as libphonenumber's FormatByPattern gives it
+// with the region's formats rewritten to dashes, which is what the table falls
+// back to. For checking the table against, and benchmarking.
+void number_format_dasherized_reference(const i18n::phonenumbers::PhoneNumber &number, std::string *out);
+
+#endif /* MINI_PHONE_NUMBER_FORMAT_H */
@@ -0,0 +1,77 @@
+#include "number_matcher.h"
+#include <algorithm>
+
+using namespace ::i18n::phonenumbers;
+
+static inline std::string reversed_nsn(const PhoneNumber &number) {
+  std::string nsn = std::to_string(number.national_number());
+  std::reverse(nsn.begin(), nsn.end());
+
+  return nsn;
+}
+
+void NumberMatcher::add(const PhoneNumber &number) {
+  index.push_back(Entry{reversed_nsn(number), static_cast<uint32_t>(references.size())});
+  references.push_back(number);
+}
+
+void NumberMatcher::build() {
+  std::sort(index.begin(), index.end(),
+            [](const Entry &a, const Entry &b) { return a.reversed_nsn < b.reversed_nsn; });
+}
+
+size_t NumberMatcher::memory_size() const {
+  size_t size = references.capacity() * sizeof(PhoneNumber) + index.capacity() * sizeof(Entry);
+
+  for (const Entry &entry : index) {
+    size += entry.reversed_nsn.capacity();
+  }
+
+  return size;
+}
+
+PhoneNumberUtil::MatchType NumberMatcher::match(const PhoneNumber &candidate) const {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  const std::string nsn = reversed_nsn(candidate);
+  PhoneNumberUtil::MatchType best = PhoneNumberUtil::NO_MATCH;
+
+  auto by_key = [](const Entry &entry, const std::string &key) { return entry.reversed_nsn < key; };
+
+  // Same NSN first (they sort before the longer ones), then the references
+  // the candidate's NSN is a suffix of. Past the equal ones only a short NSN
+  // match is possible, so one is enough.
+  for (auto it = std::lower_bound(index.begin(), index.end(), nsn, by_key);
+       it != index.end() && it->reversed_nsn.compare(0, nsn.size(), nsn) == 0; ++it) {
+    if (it->reversed_nsn.size() > nsn.size() && best >= PhoneNumberUtil::SHORT_NSN_MATCH) {
+      break;
+    }
+
+    best = std::max(best, phone_util.IsNumberMatch(references[it->reference], candidate));
+
+    if (best == PhoneNumberUtil::EXACT_MATCH) {
+      return best;
+    }
+  }
+
+  if (best >= PhoneNumberUtil::SHORT_NSN_MATCH) {
+    return best;
+  }
+
+  // References whose NSN is a suffix of the candidate's
+  std::string prefix;
+
+  for (size_t len = 1; len < nsn.size(); len++) {
+    prefix.assign(nsn, 0, len);
+
+    for (auto it = std::lower_bound(index.begin(), index.end(), prefix, by_key);
+         it != index.end() && it->reversed_nsn == prefix; ++it) {
+      best = std::max(best, phone_util.IsNumberMatch(references[it->reference], candidate));
+
+      if (best >= PhoneNumberUtil::SHORT_NSN_MATCH) {
+        return best;
+      }
+    }
+  }
+
+  return best;
+}
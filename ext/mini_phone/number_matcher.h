@@ -0,0 +1,41 @@
+#ifndef MINI_PHONE_NUMBER_MATCHER_H
+#define MINI_PHONE_NUMBER_MATCHER_H 1
+
+#include "phonenumbers/phonenumber.pb.h"
+#include "phonenumbers/phonenumberutil.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Finds the best IsNumberMatch result of a number against a whole set of
+// reference numbers, without comparing it to each of them.
+//
+// IsNumberMatch only ever reports a match when one national significant
+// number is a suffix of the other, so the references are indexed by their
+// reversed NSN: references with the same NSN, or one the candidate's is a
+// suffix of, form a contiguous range of the sorted index, and the ones which
+// are a suffix of the candidate's are found with one lookup per prefix.
+class NumberMatcher {
+public:
+  void add(const i18n::phonenumbers::PhoneNumber &number);
+  // Sorts the index, must be called after the last add and before matching.
+  void build();
+
+  // Returns the best match type among all references (NO_MATCH when there's
+  // none). Safe to call from multiple threads once built.
+  i18n::phonenumbers::PhoneNumberUtil::MatchType match(const i18n::phonenumbers::PhoneNumber &candidate) const;
+
+  size_t size() const { return references.size(); }
+  size_t memory_size() const;
+
+private:
+  struct Entry {
+    std::string reversed_nsn;
+    uint32_t reference;
+  };
+
+  std::vector<i18n::phonenumbers::PhoneNumber> references;
+  std::vector<Entry> index;
+};
+
+#endif /* MINI_PHONE_NUMBER_MATCHER_H */
@@ -0,0 +1,95 @@
+#include "number_set.h"
+
+static const size_t NUMBER_SET_MIN_CAPACITY = 16;
+
+// Grow once the table is more than 7/8 full
+static inline bool number_set_overloaded(size_t count, size_t capacity) { return count * 8 > capacity * 7; }
+
+// Packed keys differ mostly in their low bits, so mix them before picking a slot
+static inline size_t number_set_slot(uint64_t key, size_t mask) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+
+  return static_cast<size_t>(key) & mask;
+}
+
+bool NumberSet::insert(const PackedNumberKey &key) {
+  if (key.packed == 0) {
+    return wide.insert(key.binary).second;
+  }
+
+  return insert_packed(key.packed);
+}
+
+bool NumberSet::insert_packed(uint64_t key) {
+  if (slots.empty() || number_set_overloaded(count + 1, slots.size())) {
+    rehash(slots.empty() ? NUMBER_SET_MIN_CAPACITY : slots.size() * 2);
+  }
+
+  size_t mask = slots.size() - 1;
+
+  for (size_t i = number_set_slot(key, mask);; i = (i + 1) & mask) {
+    if (slots[i] == key) {
+      return false;
+    }
+
+    if (slots[i] == 0) {
+      slots[i] = key;
+      count++;
+      return true;
+    }
+  }
+}
+
+bool NumberSet::contains(const PackedNumberKey &key) const {
+  if (key.packed == 0) {
+    return wide.count(key.binary) > 0;
+  }
+
+  if (slots.empty()) {
+    return false;
+  }
+
+  size_t mask = slots.size() - 1;
+
+  for (size_t i = number_set_slot(key.packed, mask);; i = (i + 1) & mask) {
+    if (slots[i] == key.packed) {
+      return true;
+    }
+
+    if (slots[i] == 0) {
+      return false;
+    }
+  }
+}
+
+void NumberSet::clear() {
+  std::vector<uint64_t>().swap(slots);
+  count = 0;
+  std::unordered_set<std::string>().swap(wide);
+}
+
+size_t NumberSet::memsize() const {
+  size_t size = slots.capacity() * sizeof(uint64_t) + wide.bucket_count() * sizeof(void *);
+
+  for (const std::string &binary : wide) {
+    // A node holds the string next to the next pointer and the cached hash
+    size_t node = sizeof(std::string) + 2 * sizeof(void *);
+    size += node + (binary.size() < sizeof(std::string) ? 0 : binary.capacity() + 1);
+  }
+
+  return size;
+}
+
+void NumberSet::rehash(size_t capacity) {
+  std::vector<uint64_t> old_slots(capacity, 0);
+  old_slots.swap(slots);
+  count = 0;
+
+  for (uint64_t key : old_slots) {
+    if (key != 0) {
+      insert_packed(key);
+    }
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef MINI_PHONE_NUMBER_SET_H
+#define MINI_PHONE_NUMBER_SET_H 1
+
+#include "packed_number.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// A set of canonical number keys, as built by packed_number_key. Packed
+// integers go in an open addressing (linear probing) table, where 0 marks an
+// empty slot as it's never a valid packed number. The rare numbers which don't
+// fit in 64 bits (extensions mostly) are kept by their full binary form.
+class NumberSet {
+public:
+  // Returns true when the key wasn't in the set yet.
+  bool insert(const PackedNumberKey &key);
+  bool contains(const PackedNumberKey &key) const;
+  void clear();
+
+  size_t size() const { return count + wide.size(); }
+  // Approximate heap usage, for ObjectSpace.memsize_of
+  size_t memsize() const;
+
+private:
+  std::vector<uint64_t> slots;
+  size_t count = 0;
+  std::unordered_set<std::string> wide;
+
+  bool insert_packed(uint64_t key);
+  void rehash(size_t capacity);
+};
+
+#endif /* MINI_PHONE_NUMBER_SET_H */
@@ -0,0 +1,73 @@
+#include "number_shape.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+NumberScan number_scan(const char *str, size_t len) {
+  NumberScan scan = {true, false, 0};
+  const unsigned char *bytes = reinterpret_cast<const unsigned char *>(str);
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i before_zero = _mm_set1_epi8('0' - 1);
+  const __m128i after_nine = _mm_set1_epi8('9' + 1);
+  const __m128i plus = _mm_set1_epi8('+');
+  int non_ascii = 0;
+  int pluses = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+    // Bytes >= 0x80 are negative as signed chars, so they never count as digits
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, before_zero), _mm_cmplt_epi8(chunk, after_nine));
+
+    non_ascii |= _mm_movemask_epi8(chunk);
+    pluses |= _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, plus));
+    scan.digits += __builtin_popcount(_mm_movemask_epi8(is_digit));
+  }
+
+  scan.ascii = non_ascii == 0;
+  scan.has_plus = pluses != 0;
+#endif
+
+  for (; i < len; i++) {
+    unsigned char c = bytes[i];
+
+    if (c >= 0x80) {
+      scan.ascii = false;
+    } else if (c >= '0' && c <= '9') {
+      scan.digits++;
+    } else if (c == '+') {
+      scan.has_plus = true;
+    }
+  }
+
+  return scan;
+}
+
+NumberShape number_shape(const char *str, size_t len, bool region_valid_for_parsing, uint64_t *national_number) {
+  NumberScan scan = number_scan(str, len);
+
+  if (!scan.ascii) {
+    return NUMBER_SHAPE_OTHER;
+  }
+
+  if (scan.digits < 2 || (!scan.has_plus && !region_valid_for_parsing)) {
+    return NUMBER_SHAPE_JUNK;
+  }
+
+  // "+1" and 10 digits, nothing else
+  if (len == 12 && scan.digits == 11 && str[0] == '+' && str[1] == '1' && str[2] >= '2') {
+    uint64_t number = 0;
+
+    for (size_t i = 2; i < len; i++) {
+      number = number * 10 + static_cast<uint64_t>(str[i] - '0');
+    }
+
+    *national_number = number;
+
+    return NUMBER_SHAPE_NANP_E164;
+  }
+
+  return NUMBER_SHAPE_OTHER;
+}
@@ -0,0 +1,40 @@
+#ifndef MINI_PHONE_NUMBER_SHAPE_H
+#define MINI_PHONE_NUMBER_SHAPE_H 1
+
+#include <cstddef>
+#include <cstdint>
+
+// What a quick scan of the raw input tells us about a number before handing it
+// to libphonenumber's (regex heavy) parser.
+enum NumberShape {
+  // Anything else, needs the full parse.
+  NUMBER_SHAPE_OTHER,
+  // Can't possibly parse, so it can't be valid either.
+  NUMBER_SHAPE_JUNK,
+  // Exactly "+1" followed by a 10 digit national number which does not start
+  // with 0 or 1. libphonenumber parses these without any normalization, so
+  // the PhoneNumber can be built directly from the digits.
+  NUMBER_SHAPE_NANP_E164,
+};
+
+struct NumberScan {
+  bool ascii;
+  bool has_plus;
+  size_t digits;
+};
+
+// Counts the ASCII digits and looks for non-ASCII bytes and plus signs, 16
+// bytes at a time where SSE2 is available.
+NumberScan number_scan(const char *str, size_t len);
+
+// Classifies the input. Only returns NUMBER_SHAPE_JUNK when libphonenumber
+// would definitely fail to parse it:
+//
+// - ASCII input with fewer than two digits is never a viable number.
+// - ASCII input without a plus sign needs a valid region to parse against
+//   (unknown regions, "ZZ" and "001" are not).
+//
+// For NUMBER_SHAPE_NANP_E164, `national_number` is set to the parsed digits.
+NumberShape number_shape(const char *str, size_t len, bool region_valid_for_parsing, uint64_t *national_number);
+
+#endif /* MINI_PHONE_NUMBER_SHAPE_H */
@@ -0,0 +1,235 @@
+#include "packed_number.h"
+#include "region_codes.h"
+
+using namespace ::i18n::phonenumbers;
+
+static const uint8_t PACKED_NUMBER_VERSION = 1;
+
+enum PackedNumberFlag {
+  PACKED_NUMBER_ITALIAN_LEADING_ZERO = 1,
+  PACKED_NUMBER_LEADING_ZEROS = 2,
+  PACKED_NUMBER_EXTENSION = 4,
+  PACKED_NUMBER_RAW_INPUT = 8,
+};
+
+static inline void varint_append(uint64_t value, std::string *out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+
+  out->push_back(static_cast<char>(value));
+}
+
+static inline bool varint_read(const unsigned char **pos, const unsigned char *end, uint64_t *value) {
+  uint64_t result = 0;
+
+  for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+    unsigned char byte = *(*pos)++;
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static inline bool string_read(const unsigned char **pos, const unsigned char *end, std::string *value) {
+  uint64_t len;
+
+  if (!varint_read(pos, end, &len) || len > static_cast<uint64_t>(end - *pos)) {
+    return false;
+  }
+
+  value->assign(reinterpret_cast<const char *>(*pos), len);
+  *pos += len;
+
+  return true;
+}
+
+bool packed_number_encode_int(const PhoneNumber &number, uint64_t *packed) {
+  uint64_t country_code = static_cast<uint64_t>(number.country_code());
+  uint64_t national_number = number.national_number();
+  uint64_t leading_zeros = number.italian_leading_zero() ? static_cast<uint64_t>(number.number_of_leading_zeros()) : 0;
+
+  if (number.has_extension() || country_code == 0 || country_code >> PACKED_NUMBER_COUNTRY_CODE_BITS ||
+      national_number >> PACKED_NUMBER_NATIONAL_NUMBER_BITS || leading_zeros >> PACKED_NUMBER_LEADING_ZEROS_BITS ||
+      (number.italian_leading_zero() && leading_zeros == 0)) {
+    return false;
+  }
+
+  *packed = national_number | country_code << PACKED_NUMBER_NATIONAL_NUMBER_BITS |
+            leading_zeros << (PACKED_NUMBER_NATIONAL_NUMBER_BITS + PACKED_NUMBER_COUNTRY_CODE_BITS);
+
+  return true;
+}
+
+bool packed_number_decode_int(uint64_t packed, PhoneNumber *number) {
+  uint64_t national_number = packed & ((1ull << PACKED_NUMBER_NATIONAL_NUMBER_BITS) - 1);
+  uint64_t country_code =
+      (packed >> PACKED_NUMBER_NATIONAL_NUMBER_BITS) & ((1ull << PACKED_NUMBER_COUNTRY_CODE_BITS) - 1);
+  uint64_t leading_zeros = packed >> (PACKED_NUMBER_NATIONAL_NUMBER_BITS + PACKED_NUMBER_COUNTRY_CODE_BITS);
+
+  // The field has room for codes up to 1023, but calling codes stop at 999
+  if (country_code == 0 || country_code > MAX_COUNTRY_CODE || leading_zeros >> PACKED_NUMBER_LEADING_ZEROS_BITS) {
+    return false;
+  }
+
+  number->Clear();
+  number->set_country_code(static_cast<int32_t>(country_code));
+  number->set_national_number(national_number);
+
+  if (leading_zeros > 0) {
+    number->set_italian_leading_zero(true);
+
+    if (leading_zeros > 1) {
+      number->set_number_of_leading_zeros(static_cast<int32_t>(leading_zeros));
+    }
+  }
+
+  return true;
+}
+
+static inline int32_t canonical_leading_zeros(const PhoneNumber &number) {
+  return number.italian_leading_zero() ? number.number_of_leading_zeros() : 0;
+}
+
+void packed_number_key(const PhoneNumber &number, PackedNumberKey *key) {
+  PhoneNumber canonical;
+  int32_t leading_zeros = canonical_leading_zeros(number);
+
+  canonical.set_country_code(number.country_code());
+  canonical.set_national_number(number.national_number());
+
+  if (number.italian_leading_zero()) {
+    canonical.set_italian_leading_zero(true);
+
+    if (leading_zeros != 1) {
+      canonical.set_number_of_leading_zeros(leading_zeros);
+    }
+  }
+
+  if (!number.extension().empty()) {
+    canonical.set_extension(number.extension());
+  }
+
+  key->binary.clear();
+
+  if (!packed_number_encode_int(canonical, &key->packed)) {
+    key->packed = 0;
+    packed_number_encode(canonical, false, &key->binary);
+  }
+}
+
+bool packed_number_equal(const PhoneNumber &a, const PhoneNumber &b) {
+  return a.country_code() == b.country_code() && a.national_number() == b.national_number() &&
+         a.italian_leading_zero() == b.italian_leading_zero() &&
+         canonical_leading_zeros(a) == canonical_leading_zeros(b) && a.extension() == b.extension();
+}
+
+// splitmix64's finalizer
+static inline uint64_t mix64(uint64_t value) {
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+
+  return value ^ (value >> 31);
+}
+
+uint64_t packed_number_hash(const PhoneNumber &number) {
+  uint64_t hash = mix64(number.national_number());
+  hash = mix64(hash ^ static_cast<uint64_t>(number.country_code()));
+  hash = mix64(hash ^ static_cast<uint64_t>(canonical_leading_zeros(number)));
+
+  for (char c : number.extension()) {
+    hash = mix64(hash ^ static_cast<unsigned char>(c));
+  }
+
+  return hash;
+}
+
+void packed_number_encode(const PhoneNumber &number, bool raw_input, std::string *packed) {
+  uint8_t flags = 0;
+
+  if (number.italian_leading_zero()) {
+    flags |= PACKED_NUMBER_ITALIAN_LEADING_ZERO;
+  }
+
+  if (number.has_number_of_leading_zeros()) {
+    flags |= PACKED_NUMBER_LEADING_ZEROS;
+  }
+
+  if (number.has_extension()) {
+    flags |= PACKED_NUMBER_EXTENSION;
+  }
+
+  if (raw_input && number.has_raw_input()) {
+    flags |= PACKED_NUMBER_RAW_INPUT;
+  }
+
+  packed->clear();
+  packed->push_back(static_cast<char>(PACKED_NUMBER_VERSION << 4 | flags));
+  varint_append(static_cast<uint64_t>(number.country_code()), packed);
+  varint_append(number.national_number(), packed);
+
+  if (flags & PACKED_NUMBER_LEADING_ZEROS) {
+    varint_append(static_cast<uint64_t>(number.number_of_leading_zeros()), packed);
+  }
+
+  if (flags & PACKED_NUMBER_EXTENSION) {
+    varint_append(number.extension().size(), packed);
+    packed->append(number.extension());
+  }
+
+  if (flags & PACKED_NUMBER_RAW_INPUT) {
+    varint_append(number.raw_input().size(), packed);
+    packed->append(number.raw_input());
+  }
+}
+
+bool packed_number_decode(const char *packed, size_t len, PhoneNumber *number) {
+  const unsigned char *pos = reinterpret_cast<const unsigned char *>(packed);
+  const unsigned char *end = pos + len;
+  uint64_t country_code;
+  uint64_t national_number;
+  uint64_t leading_zeros;
+
+  if (pos == end || *pos >> 4 != PACKED_NUMBER_VERSION) {
+    return false;
+  }
+
+  uint8_t flags = *pos++ & 0x0f;
+
+  if (!varint_read(&pos, end, &country_code) || !varint_read(&pos, end, &national_number) || country_code == 0 ||
+      country_code > MAX_COUNTRY_CODE) {
+    return false;
+  }
+
+  number->Clear();
+  number->set_country_code(static_cast<int32_t>(country_code));
+  number->set_national_number(national_number);
+
+  if (flags & PACKED_NUMBER_ITALIAN_LEADING_ZERO) {
+    number->set_italian_leading_zero(true);
+  }
+
+  if (flags & PACKED_NUMBER_LEADING_ZEROS) {
+    if (!varint_read(&pos, end, &leading_zeros) || leading_zeros > INT32_MAX) {
+      return false;
+    }
+
+    number->set_number_of_leading_zeros(static_cast<int32_t>(leading_zeros));
+  }
+
+  if ((flags & PACKED_NUMBER_EXTENSION) && !string_read(&pos, end, number->mutable_extension())) {
+    return false;
+  }
+
+  if ((flags & PACKED_NUMBER_RAW_INPUT) && !string_read(&pos, end, number->mutable_raw_input())) {
+    return false;
+  }
+
+  return pos == end;
+}
@@ -0,0 +1,52 @@
+#ifndef MINI_PHONE_PACKED_NUMBER_H
+#define MINI_PHONE_PACKED_NUMBER_H 1
+
+#include "phonenumbers/phonenumber.pb.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Compact encodings of the fields of a parsed number, so stored numbers can
+// be loaded back without going through ParseAndKeepRawInput.
+//
+// The 64 bit form covers the common case (no extension):
+//
+//   bits  0-49  national number
+//   bits 50-59  country code
+//   bits 60-62  number of leading zeros, 0 when there's no italian leading zero
+//   bit  63     always 0, so the value fits in a signed 64 bit column
+//
+// The binary form holds everything: a header byte (version in the high
+// nibble, PACKED_NUMBER_* flags in the low one), then the country code and
+// national number as varints, followed by the optional fields present.
+static const uint64_t PACKED_NUMBER_NATIONAL_NUMBER_BITS = 50;
+static const uint64_t PACKED_NUMBER_COUNTRY_CODE_BITS = 10;
+static const uint64_t PACKED_NUMBER_LEADING_ZEROS_BITS = 3;
+
+// Returns false when the number doesn't fit in 64 bits.
+bool packed_number_encode_int(const i18n::phonenumbers::PhoneNumber &number, uint64_t *packed);
+bool packed_number_decode_int(uint64_t packed, i18n::phonenumbers::PhoneNumber *number);
+
+// The canonical identity of a parsed number: country code, national number,
+// leading zeros and extension, where an empty extension is the same as none
+// (as it is for IsNumberMatch). `packed` is the packed integer when the number
+// fits in 64 bits, otherwise it's 0 and `binary` holds the binary form.
+struct PackedNumberKey {
+  uint64_t packed = 0;
+  std::string binary;
+
+  bool empty() const { return packed == 0 && binary.empty(); }
+  bool operator==(const PackedNumberKey &other) const { return packed == other.packed && binary == other.binary; }
+};
+
+void packed_number_key(const i18n::phonenumbers::PhoneNumber &number, PackedNumberKey *key);
+// Whether both numbers have the same canonical key, without building it.
+bool packed_number_equal(const i18n::phonenumbers::PhoneNumber &a, const i18n::phonenumbers::PhoneNumber &b);
+// A hash consistent with packed_number_equal.
+uint64_t packed_number_hash(const i18n::phonenumbers::PhoneNumber &number);
+
+void packed_number_encode(const i18n::phonenumbers::PhoneNumber &number, bool raw_input, std::string *packed);
+// Returns false for malformed input.
+bool packed_number_decode(const char *packed, size_t len, i18n::phonenumbers::PhoneNumber *number);
+
+#endif /* MINI_PHONE_PACKED_NUMBER_H */
@@ -0,0 +1,111 @@
+#include "parse_cache.h"
+#include "phonenumbers/phonenumberutil.h"
+#include "stats.h"
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+using namespace ::i18n::phonenumbers;
+
+typedef std::pair<std::string, std::shared_ptr<ParseCacheEntry>> ParseCacheItem;
+
+// Least recently used items are at the back of the list.
+static std::mutex cache_mutex;
+static std::list<ParseCacheItem> cache_items;
+static std::unordered_map<std::string, std::list<ParseCacheItem>::iterator> cache_index;
+static std::atomic<size_t> cache_capacity{0};
+static size_t cache_hits = 0;
+static size_t cache_misses = 0;
+static size_t cache_evictions = 0;
+
+static inline void parse_cache_evict(size_t capacity) {
+  while (cache_items.size() > capacity) {
+    cache_index.erase(cache_items.back().first);
+    cache_items.pop_back();
+    cache_evictions++;
+  }
+}
+
+// Builds the key in a thread local buffer, so lookups don't allocate
+static inline std::string &parse_cache_key(const std::string &number, const std::string &region_code) {
+  static thread_local std::string key;
+  key.assign(region_code);
+  key.push_back('\0');
+  key.append(number);
+
+  return key;
+}
+
+void parse_cache_set_capacity(size_t capacity) {
+  std::lock_guard<std::mutex> guard(cache_mutex);
+
+  cache_capacity.store(capacity, std::memory_order_relaxed);
+  parse_cache_evict(capacity);
+}
+
+bool parse_cache_enabled() { return cache_capacity.load(std::memory_order_relaxed) > 0; }
+
+std::shared_ptr<ParseCacheEntry> parse_cache_fetch(const std::string &number, const std::string &region_code) {
+  const std::string &key = parse_cache_key(number, region_code);
+
+  {
+    std::lock_guard<std::mutex> guard(cache_mutex);
+    auto found = cache_index.find(key);
+
+    if (found != cache_index.end()) {
+      cache_hits++;
+      cache_items.splice(cache_items.begin(), cache_items, found->second);
+
+      return found->second->second;
+    }
+
+    cache_misses++;
+  }
+
+  // Parse outside of the lock, so a miss does not block every other thread.
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  auto entry = std::make_shared<ParseCacheEntry>();
+
+  {
+    StatsTimer timer(STATS_PHASE_PARSE, &region_code);
+    auto result = phone_util.ParseAndKeepRawInput(number, region_code, &entry->number);
+    entry->parsed_ok = result == PhoneNumberUtil::NO_PARSING_ERROR;
+  }
+
+  std::lock_guard<std::mutex> guard(cache_mutex);
+  size_t capacity = cache_capacity.load(std::memory_order_relaxed);
+
+  if (capacity == 0) {
+    return entry;
+  }
+
+  auto found = cache_index.find(key);
+
+  if (found != cache_index.end()) {
+    // Another thread parsed the same number in the meantime.
+    return found->second->second;
+  }
+
+  cache_items.emplace_front(key, entry);
+  cache_index.emplace(key, cache_items.begin());
+  parse_cache_evict(capacity);
+
+  return entry;
+}
+
+ParseCacheStats parse_cache_stats() {
+  std::lock_guard<std::mutex> guard(cache_mutex);
+
+  return ParseCacheStats{cache_hits, cache_misses, cache_evictions, cache_items.size(),
+                         cache_capacity.load(std::memory_order_relaxed)};
+}
+
+void parse_cache_clear() {
+  std::lock_guard<std::mutex> guard(cache_mutex);
+
+  cache_items.clear();
+  cache_index.clear();
+  cache_hits = 0;
+  cache_misses = 0;
+  cache_evictions = 0;
+}
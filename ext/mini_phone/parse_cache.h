@@ -0,0 +1,44 @@
+#ifndef MINI_PHONE_PARSE_CACHE_H
+#define MINI_PHONE_PARSE_CACHE_H 1
+
+#include "phonenumbers/phonenumber.pb.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// A parsed number as stored in the parse cache. Entries are shared between
+// threads, so the lazily computed results are filled in atomically by
+// whichever caller needs them first. -1 means "not computed yet".
+struct ParseCacheEntry {
+  i18n::phonenumbers::PhoneNumber number;
+  bool parsed_ok;
+  std::atomic<int8_t> valid{-1};
+  std::atomic<int8_t> type{-1};
+  std::once_flag e164_once;
+  std::string e164;
+};
+
+struct ParseCacheStats {
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+  size_t size;
+  size_t capacity;
+};
+
+// The cache is disabled (capacity 0) until a capacity is set.
+void parse_cache_set_capacity(size_t capacity);
+bool parse_cache_enabled();
+
+// Returns the cached parse of `number` for `region_code`, parsing it (with
+// ParseAndKeepRawInput) and inserting it on a miss. Safe to call without the
+// GVL and from multiple threads.
+std::shared_ptr<ParseCacheEntry> parse_cache_fetch(const std::string &number, const std::string &region_code);
+
+ParseCacheStats parse_cache_stats();
+void parse_cache_clear();
+
+#endif /* MINI_PHONE_PARSE_CACHE_H */
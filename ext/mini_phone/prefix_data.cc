@@ -0,0 +1,306 @@
+#include "prefix_data.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct PrefixDataHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t table_count;
+  uint32_t node_count;
+  uint32_t strings_size;
+  uint8_t reserved[8];
+};
+
+struct PrefixDataTable {
+  uint32_t kind;
+  uint32_t root;
+  char locale[24];
+};
+
+struct PrefixDataNode {
+  uint32_t first_child;
+  uint32_t value;
+  uint16_t child_mask;
+  uint16_t reserved;
+};
+
+static_assert(sizeof(PrefixDataHeader) == 32, "the header is 32 bytes");
+static_assert(sizeof(PrefixDataTable) == 32, "tables are 32 bytes");
+static_assert(sizeof(PrefixDataNode) == 12, "nodes are 12 bytes");
+
+static const char PREFIX_DATA_MAGIC[8] = {'M', 'P', 'P', 'R', 'E', 'F', 'I', 'X'};
+
+struct PrefixData {
+  size_t size;
+  const PrefixDataTable *tables;
+  uint32_t table_count;
+  const PrefixDataNode *nodes;
+  uint32_t node_count;
+  const char *strings;
+  uint32_t strings_size;
+};
+
+// Published once complete, and never unmapped when replaced since a lookup
+// may still be running on another thread. Data is replaced rarely, if ever.
+static std::atomic<const PrefixData *> prefix_data{nullptr};
+
+// Returns the contents of the file, mapped where mmap is available and read
+// into memory otherwise. Either way it's aligned enough for the structs above.
+static const char *prefix_data_read(const char *path, size_t *size, std::string *error) {
+#ifdef HAVE_SYS_MMAN_H
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0) {
+    *error = strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st;
+
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    *error = "not a prefix data file";
+    return nullptr;
+  }
+
+  *size = static_cast<size_t>(st.st_size);
+  void *mapped = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (mapped == MAP_FAILED) {
+    *error = strerror(errno);
+    return nullptr;
+  }
+
+  // Lookups jump around the trie
+  madvise(mapped, *size, MADV_RANDOM);
+
+  return static_cast<const char *>(mapped);
+#else
+  FILE *file = fopen(path, "rb");
+
+  if (file == nullptr) {
+    *error = strerror(errno);
+    return nullptr;
+  }
+
+  std::string contents;
+  char buffer[65536];
+  size_t n;
+
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents.append(buffer, n);
+  }
+
+  fclose(file);
+
+  uint32_t *data = new uint32_t[contents.size() / sizeof(uint32_t) + 1];
+  memcpy(data, contents.data(), contents.size());
+  *size = contents.size();
+
+  return reinterpret_cast<const char *>(data);
+#endif
+}
+
+static void prefix_data_release(const char *base, size_t size) {
+#ifdef HAVE_SYS_MMAN_H
+  munmap(const_cast<char *>(base), size);
+#else
+  delete[] reinterpret_cast<const uint32_t *>(base);
+#endif
+}
+
+// Only the header and the table list are checked up front, lookups check
+// the bounds of every node they visit instead of walking the whole file.
+static bool prefix_data_check(const char *base, size_t size, PrefixData *data, std::string *error) {
+  if (size < sizeof(PrefixDataHeader) || memcmp(base, PREFIX_DATA_MAGIC, sizeof(PREFIX_DATA_MAGIC)) != 0) {
+    *error = "not a prefix data file";
+    return false;
+  }
+
+  const PrefixDataHeader *header = reinterpret_cast<const PrefixDataHeader *>(base);
+
+  if (header->version != PREFIX_DATA_VERSION) {
+    *error = "unsupported prefix data version " + std::to_string(header->version);
+    return false;
+  }
+
+  uint64_t expected_size = sizeof(PrefixDataHeader) + uint64_t(header->table_count) * sizeof(PrefixDataTable) +
+                           uint64_t(header->node_count) * sizeof(PrefixDataNode) + header->strings_size;
+
+  if (expected_size != size || header->strings_size == 0) {
+    *error = "truncated prefix data file";
+    return false;
+  }
+
+  data->size = size;
+  data->tables = reinterpret_cast<const PrefixDataTable *>(base + sizeof(PrefixDataHeader));
+  data->table_count = header->table_count;
+  data->nodes = reinterpret_cast<const PrefixDataNode *>(data->tables + data->table_count);
+  data->node_count = header->node_count;
+  data->strings = reinterpret_cast<const char *>(data->nodes + data->node_count);
+  data->strings_size = header->strings_size;
+
+  if (data->strings[data->strings_size - 1] != '\0') {
+    *error = "corrupt prefix data strings";
+    return false;
+  }
+
+  for (uint32_t i = 0; i < data->table_count; i++) {
+    const PrefixDataTable &table = data->tables[i];
+
+    if (table.kind >= PREFIX_DATA_KIND_COUNT || table.root >= data->node_count ||
+        memchr(table.locale, '\0', sizeof(table.locale)) == nullptr) {
+      *error = "corrupt prefix data table";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool prefix_data_open(const char *path, std::string *error) {
+  size_t size = 0;
+  const char *base = prefix_data_read(path, &size, error);
+
+  if (base == nullptr) {
+    return false;
+  }
+
+  PrefixData *data = new PrefixData();
+
+  if (!prefix_data_check(base, size, data, error)) {
+    prefix_data_release(base, size);
+    delete data;
+    return false;
+  }
+
+  prefix_data.store(data, std::memory_order_release);
+
+  return true;
+}
+
+bool prefix_data_loaded() { return prefix_data.load(std::memory_order_acquire) != nullptr; }
+
+PrefixDataInfo prefix_data_info() {
+  const PrefixData *data = prefix_data.load(std::memory_order_acquire);
+  PrefixDataInfo info;
+  info.bytes = 0;
+
+  if (data == nullptr) {
+    return info;
+  }
+
+  info.bytes = data->size;
+
+  for (uint32_t i = 0; i < data->table_count; i++) {
+    info.locales[data->tables[i].kind].push_back(data->tables[i].locale);
+  }
+
+  return info;
+}
+
+static const PrefixDataTable *prefix_data_table(const PrefixData *data, PrefixDataKind kind,
+                                                const std::string &locale) {
+  for (uint32_t i = 0; i < data->table_count; i++) {
+    const PrefixDataTable &table = data->tables[i];
+
+    if (table.kind == kind && locale.size() < sizeof(table.locale) &&
+        memcmp(table.locale, locale.c_str(), locale.size() + 1) == 0) {
+      return &table;
+    }
+  }
+
+  return nullptr;
+}
+
+// Walks `digits` down the trie. Returns false when the table has nothing for
+// the first `required` digits (the country calling code), otherwise the value
+// of the longest prefix with one (0 for none) is stored in `value`.
+static bool prefix_data_walk(const PrefixData *data, const PrefixDataTable *table, const std::string &digits,
+                             size_t required, uint32_t *value) {
+  const PrefixDataNode *node = &data->nodes[table->root];
+  size_t depth = 0;
+  *value = node->value;
+
+  for (char c : digits) {
+    unsigned digit = static_cast<unsigned>(c - '0');
+
+    if (digit > 9 || !(node->child_mask & (1u << digit))) {
+      break;
+    }
+
+    uint32_t child = node->first_child + __builtin_popcount(node->child_mask & ((1u << digit) - 1));
+
+    if (child >= data->node_count) {
+      break;
+    }
+
+    node = &data->nodes[child];
+    depth++;
+
+    if (node->value != 0) {
+      *value = node->value;
+    }
+  }
+
+  return depth >= required;
+}
+
+const char *prefix_data_lookup(PrefixDataKind kind, const std::string &locale, int country_code,
+                               const std::string &national_significant_number) {
+  const PrefixData *data = prefix_data.load(std::memory_order_acquire);
+
+  if (data == nullptr) {
+    return nullptr;
+  }
+
+  std::string digits = std::to_string(country_code);
+  size_t required = digits.size();
+  digits.append(national_significant_number);
+
+  std::string candidates[3];
+  candidates[0] = locale;
+
+  for (char &c : candidates[0]) {
+    if (c == '-') {
+      c = '_';
+    }
+  }
+
+  candidates[1] = candidates[0].substr(0, candidates[0].find('_'));
+
+  if (candidates[1] != "zh" && candidates[1] != "ja" && candidates[1] != "ko") {
+    candidates[2] = "en";
+  }
+
+  for (int i = 0; i < 3; i++) {
+    if (candidates[i].empty() || (i > 0 && candidates[i] == candidates[i - 1])) {
+      continue;
+    }
+
+    const PrefixDataTable *table = prefix_data_table(data, kind, candidates[i]);
+    uint32_t value;
+
+    if (table == nullptr || !prefix_data_walk(data, table, digits, required, &value)) {
+      continue;
+    }
+
+    if (value == 0 || value > data->strings_size || data->strings[value - 1] == '\0') {
+      return nullptr;
+    }
+
+    return data->strings + value - 1;
+  }
+
+  return nullptr;
+}
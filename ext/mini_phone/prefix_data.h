@@ -0,0 +1,53 @@
+#ifndef MINI_PHONE_PREFIX_DATA_H
+#define MINI_PHONE_PREFIX_DATA_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Carrier names and geographical descriptions from libphonenumber's prefix
+// files, compiled by MiniPhone::PrefixData (lib/mini_phone/prefix_data.rb)
+// into a single read-only file which is mapped into memory as is. Nothing is
+// deserialized when it's opened, and forked processes share the pages.
+//
+// The file holds one digit trie per kind and locale, keyed by the country
+// calling code followed by the national significant number. All integers are
+// little endian:
+//
+//   header   "MPPREFIX", u32 version, u32 table count, u32 node count,
+//            u32 strings size, 8 reserved bytes
+//   tables   u32 kind, u32 root node, 24 byte NUL padded locale
+//   nodes    u32 first child, u32 value (string offset + 1, 0 for none),
+//            u16 child mask (bit n set when there's a child for digit n),
+//            2 reserved bytes
+//   strings  NUL terminated UTF-8
+//
+// The children of a node are stored next to each other in digit order, so
+// the child for a digit is `first child + popcount(mask below the digit)`.
+
+enum PrefixDataKind : uint32_t { PREFIX_DATA_CARRIER, PREFIX_DATA_GEOCODING, PREFIX_DATA_KIND_COUNT };
+
+static const uint32_t PREFIX_DATA_VERSION = 1;
+
+struct PrefixDataInfo {
+  size_t bytes;
+  std::vector<std::string> locales[PREFIX_DATA_KIND_COUNT];
+};
+
+// Maps the file at `path`, replacing the data opened before. On failure the
+// previous data stays in place and `error` says why.
+bool prefix_data_open(const char *path, std::string *error);
+
+bool prefix_data_loaded();
+PrefixDataInfo prefix_data_info();
+
+// Returns the description for the longest prefix of the number which has
+// one, or NULL. Like libphonenumber, the locale ("de_CH", "zh_Hant") is tried
+// as is, then its language, then English (except for Chinese, Japanese and
+// Korean), using the first one with data for the country calling code. Safe
+// to call without the GVL.
+const char *prefix_data_lookup(PrefixDataKind kind, const std::string &locale, int country_code,
+                               const std::string &national_significant_number);
+
+#endif /* MINI_PHONE_PREFIX_DATA_H */
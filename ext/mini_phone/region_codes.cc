@@ -0,0 +1,255 @@
+#include "region_codes.h"
+#include "compiled_metadata.h"
+#include "phonenumbers/phonemetadata.pb.h"
+#include "phonenumbers/phonenumberutil.h"
+#include <atomic>
+#include <list>
+#include <set>
+#include <vector>
+
+using namespace ::i18n::phonenumbers;
+
+// Two letter codes are looked up in a 26 * 26 array, "001" is special cased.
+struct RegionCodeTable {
+  std::vector<RegionCode> regions;
+  const RegionCode *by_letters[26 * 26] = {};
+  const RegionCode *non_geo = nullptr;
+  const RegionCode *unknown = nullptr;
+  const RegionCode *by_country_code[MAX_COUNTRY_CODE + 1] = {};
+};
+
+static inline int region_code_letters_index(const char *code) {
+  if (code[0] < 'A' || code[0] > 'Z' || code[1] < 'A' || code[1] > 'Z') {
+    return -1;
+  }
+
+  return (code[0] - 'A') * 26 + (code[1] - 'A');
+}
+
+static inline const RegionCode *region_code_lookup(const RegionCodeTable *table, const std::string &code) {
+  if (code.size() == 2) {
+    int index = region_code_letters_index(code.data());
+
+    return index < 0 ? nullptr : table->by_letters[index];
+  }
+
+  return code == "001" ? table->non_geo : nullptr;
+}
+
+static const RegionCodeTable *region_code_table_build() {
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  RegionCodeTable *table = new RegionCodeTable();
+  std::set<std::string> supported;
+
+  phone_util.GetSupportedRegions(&supported);
+  supported.insert("ZZ");
+  supported.insert("001");
+
+  // Reserve up front, the table hands out pointers into the vector
+  table->regions.reserve(supported.size());
+
+  for (const std::string &code : supported) {
+    int country_code = code == "ZZ" ? 0 : phone_util.GetCountryCodeForRegion(code);
+    table->regions.push_back(RegionCode{code, table->regions.size(), country_code});
+  }
+
+  for (const RegionCode &region : table->regions) {
+    if (region.code == "001") {
+      table->non_geo = &region;
+    } else if (region.code.size() == 2 && region_code_letters_index(region.code.data()) >= 0) {
+      table->by_letters[region_code_letters_index(region.code.data())] = &region;
+    }
+  }
+
+  table->unknown = table->by_letters[region_code_letters_index("ZZ")];
+
+  for (int country_code = 1; country_code <= MAX_COUNTRY_CODE; country_code++) {
+    std::string code;
+    phone_util.GetRegionCodeForCountryCode(country_code, &code);
+
+    const RegionCode *region = region_code_lookup(table, code);
+    table->by_country_code[country_code] = region == nullptr ? table->unknown : region;
+  }
+
+  return table;
+}
+
+static inline const RegionCodeTable &region_code_table() {
+  // Built lazily on first use, function local statics are thread safe
+  static const RegionCodeTable *table = region_code_table_build();
+
+  return *table;
+}
+
+const RegionCode *region_code_lookup(const char *code, size_t len) {
+  const RegionCodeTable &table = region_code_table();
+
+  if (len == 2) {
+    int index = region_code_letters_index(code);
+
+    return index < 0 ? nullptr : table.by_letters[index];
+  }
+
+  if (len == 3 && code[0] == '0' && code[1] == '0' && code[2] == '1') {
+    return table.non_geo;
+  }
+
+  return nullptr;
+}
+
+const RegionCode *region_code_for_country_code(int country_code) {
+  const RegionCodeTable &table = region_code_table();
+
+  if (country_code < 1 || country_code > MAX_COUNTRY_CODE) {
+    return table.unknown;
+  }
+
+  return table.by_country_code[country_code];
+}
+
+bool region_code_valid_for_parsing(const char *code, size_t len) {
+  const RegionCode *region = region_code_lookup(code, len);
+
+  return region != nullptr && region != region_code_unknown() && region->code.size() == 2;
+}
+
+const RegionCode *region_code_unknown() { return region_code_table().unknown; }
+
+size_t region_code_count() { return region_code_table().regions.size(); }
+
+const RegionCode *region_code_at(size_t index) { return &region_code_table().regions[index]; }
+
+// Restrictions are immutable once published, so they can be read without the
+// GVL or a lock. Replaced ones are never freed, as a thread may still be
+// holding on to them; they're small and replaced rarely.
+struct RegionRestriction {
+  std::vector<const RegionCode *> regions;
+  std::vector<bool> allowed;
+  RegionCheck by_country_code[MAX_COUNTRY_CODE + 1];
+};
+
+static std::atomic<const RegionRestriction *> region_restriction{nullptr};
+
+void region_codes_restrict(const std::vector<const RegionCode *> &regions) {
+  if (regions.empty()) {
+    region_restriction.store(nullptr, std::memory_order_release);
+    return;
+  }
+
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  const RegionCodeTable &table = region_code_table();
+  RegionRestriction *restriction = new RegionRestriction();
+  restriction->allowed.resize(table.regions.size(), false);
+
+  for (const RegionCode *region : regions) {
+    if (!restriction->allowed[region->index]) {
+      restriction->allowed[region->index] = true;
+      restriction->regions.push_back(region);
+    }
+  }
+
+  restriction->by_country_code[0] = REGION_CHECK_REJECTED;
+
+  for (int country_code = 1; country_code <= MAX_COUNTRY_CODE; country_code++) {
+    std::list<std::string> codes;
+    size_t allowed = 0;
+
+    phone_util.GetRegionCodesForCountryCallingCode(country_code, &codes);
+
+    for (const std::string &code : codes) {
+      const RegionCode *region = region_code_lookup(&table, code);
+
+      if (region != nullptr && restriction->allowed[region->index]) {
+        allowed++;
+      }
+    }
+
+    if (allowed == 0) {
+      restriction->by_country_code[country_code] = REGION_CHECK_REJECTED;
+    } else if (allowed == codes.size()) {
+      restriction->by_country_code[country_code] = REGION_CHECK_ALLOWED;
+    } else {
+      restriction->by_country_code[country_code] = REGION_CHECK_BY_REGION;
+    }
+  }
+
+  region_restriction.store(restriction, std::memory_order_release);
+}
+
+std::vector<const RegionCode *> region_codes_allowed() {
+  const RegionRestriction *restriction = region_restriction.load(std::memory_order_acquire);
+
+  return restriction == nullptr ? std::vector<const RegionCode *>() : restriction->regions;
+}
+
+// Serialized metadata size per region (the non-geographical entities all
+// have the id "001"), read from the metadata on first use.
+static const std::vector<size_t> &region_code_metadata_bytes() {
+  static const std::vector<size_t> *bytes = [] {
+    const RegionCodeTable &table = region_code_table();
+    auto *bytes = new std::vector<size_t>(table.regions.size(), 0);
+    PhoneMetadataCollection collection;
+
+    if (!collection.ParseFromArray(metadata_get(), metadata_size())) {
+      return bytes;
+    }
+
+    for (const PhoneMetadata &metadata : collection.metadata()) {
+      const RegionCode *region = region_code_lookup(&table, metadata.id());
+
+      if (region != nullptr) {
+        (*bytes)[region->index] += metadata.ByteSizeLong();
+      }
+    }
+
+    return bytes;
+  }();
+
+  return *bytes;
+}
+
+RegionRestrictionReport region_codes_restriction_report() {
+  const RegionRestriction *restriction = region_restriction.load(std::memory_order_acquire);
+  const std::vector<size_t> &bytes = region_code_metadata_bytes();
+  RegionRestrictionReport report{0, 0, 0, 0};
+
+  for (const RegionCode &region : region_code_table().regions) {
+    if (region.code == "ZZ") {
+      continue;
+    }
+
+    if (restriction == nullptr || restriction->allowed[region.index]) {
+      report.regions++;
+      report.metadata_bytes += bytes[region.index];
+    } else {
+      report.excluded_metadata_bytes += bytes[region.index];
+    }
+  }
+
+  for (int country_code = 1; country_code <= MAX_COUNTRY_CODE; country_code++) {
+    if (restriction != nullptr ? restriction->by_country_code[country_code] != REGION_CHECK_REJECTED
+                               : region_code_for_country_code(country_code) != region_code_unknown()) {
+      report.country_codes++;
+    }
+  }
+
+  return report;
+}
+
+const RegionRestriction *region_codes_restriction() { return region_restriction.load(std::memory_order_acquire); }
+
+RegionCheck region_code_check_country_code(const RegionRestriction *restriction, int country_code) {
+  if (restriction == nullptr) {
+    return REGION_CHECK_ALLOWED;
+  }
+
+  if (country_code < 0 || country_code > MAX_COUNTRY_CODE) {
+    return REGION_CHECK_REJECTED;
+  }
+
+  return restriction->by_country_code[country_code];
+}
+
+bool region_code_allowed(const RegionRestriction *restriction, const RegionCode *region) {
+  return restriction == nullptr || (region != nullptr && restriction->allowed[region->index]);
+}
@@ -0,0 +1,73 @@
+#ifndef MINI_PHONE_REGION_CODES_H
+#define MINI_PHONE_REGION_CODES_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The largest country calling code, they have at most three digits. Tables
+// indexed by calling code have MAX_COUNTRY_CODE + 1 entries.
+static const int MAX_COUNTRY_CODE = 999;
+
+// A region code known to libphonenumber, interned once so lookups never have
+// to allocate a std::string per call. Besides the supported regions, the table
+// holds "ZZ" (unknown region) and "001" (non-geographical entities).
+struct RegionCode {
+  std::string code;
+  size_t index;
+  int country_code;
+};
+
+// Returns the interned region code for the given bytes, or NULL when it is
+// not a region code libphonenumber knows about. Region codes are case
+// sensitive, just like they are for libphonenumber.
+const RegionCode *region_code_lookup(const char *code, size_t len);
+
+// Returns the main region for a country calling code (the one
+// GetRegionCodeForCountryCode picks), "ZZ" for unknown codes.
+const RegionCode *region_code_for_country_code(int country_code);
+
+// Whether libphonenumber can parse numbers without a leading plus against the
+// region: "ZZ", "001" and unknown codes are rejected by CheckRegionForParsing.
+bool region_code_valid_for_parsing(const char *code, size_t len);
+
+const RegionCode *region_code_unknown();
+size_t region_code_count();
+const RegionCode *region_code_at(size_t index);
+
+// Restricting regions
+//
+// With a restriction in place, only numbers from the allowed regions are
+// valid. Most numbers are accepted or rejected on their country calling code
+// alone, only codes shared by allowed and disallowed regions (like +1 when
+// just "US" is allowed) need the region of the number to decide.
+
+enum RegionCheck : uint8_t { REGION_CHECK_ALLOWED, REGION_CHECK_REJECTED, REGION_CHECK_BY_REGION };
+
+struct RegionRestrictionReport {
+  size_t regions;
+  size_t country_codes;
+  // Serialized metadata of the allowed and of the excluded regions
+  size_t metadata_bytes;
+  size_t excluded_metadata_bytes;
+};
+
+// Allows only the given regions, an empty list lifts the restriction.
+void region_codes_restrict(const std::vector<const RegionCode *> &regions);
+
+// The allowed regions, empty when there is no restriction.
+std::vector<const RegionCode *> region_codes_allowed();
+
+RegionRestrictionReport region_codes_restriction_report();
+
+// The restriction in place, nullptr when there is none. A validation loads it
+// once and passes it to the checks below, so that it sees a single
+// restriction even when restrict_regions runs at the same time.
+struct RegionRestriction;
+const RegionRestriction *region_codes_restriction();
+
+RegionCheck region_code_check_country_code(const RegionRestriction *restriction, int country_code);
+bool region_code_allowed(const RegionRestriction *restriction, const RegionCode *region);
+
+#endif /* MINI_PHONE_REGION_CODES_H */
@@ -0,0 +1,60 @@
+#include "stats.h"
+#include "region_codes.h"
+
+// Padded to a cache line each, since worker threads bump them concurrently.
+struct alignas(64) StatsSlot {
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> ns{0};
+};
+
+std::atomic<bool> stats_enabled_flag{false};
+
+static StatsSlot phase_slots[STATS_PHASE_COUNT];
+
+static const char *phase_names[STATS_PHASE_COUNT] = {"input", "parse", "validate", "type", "format"};
+
+static StatsSlot *region_slots() {
+  static StatsSlot *slots = new StatsSlot[region_code_count()];
+
+  return slots;
+}
+
+static inline void stats_slot_add(StatsSlot *slot, uint64_t ns) {
+  slot->calls.fetch_add(1, std::memory_order_relaxed);
+  slot->ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+static inline StatsCounters stats_slot_read(const StatsSlot *slot) {
+  return StatsCounters{slot->calls.load(std::memory_order_relaxed), slot->ns.load(std::memory_order_relaxed)};
+}
+
+void stats_set_enabled(bool enabled) { stats_enabled_flag.store(enabled, std::memory_order_relaxed); }
+
+void stats_record(StatsPhase phase, uint64_t ns, const std::string *region_code) {
+  stats_slot_add(&phase_slots[phase], ns);
+
+  if (region_code != nullptr) {
+    const RegionCode *region = region_code_lookup(region_code->data(), region_code->size());
+    stats_slot_add(&region_slots()[(region == nullptr ? region_code_unknown() : region)->index], ns);
+  }
+}
+
+const char *stats_phase_name(StatsPhase phase) { return phase_names[phase]; }
+
+StatsCounters stats_phase(StatsPhase phase) { return stats_slot_read(&phase_slots[phase]); }
+
+StatsCounters stats_region(size_t index) { return stats_slot_read(&region_slots()[index]); }
+
+void stats_reset() {
+  for (StatsSlot &slot : phase_slots) {
+    slot.calls.store(0, std::memory_order_relaxed);
+    slot.ns.store(0, std::memory_order_relaxed);
+  }
+
+  StatsSlot *slots = region_slots();
+
+  for (size_t i = 0; i < region_code_count(); i++) {
+    slots[i].calls.store(0, std::memory_order_relaxed);
+    slots[i].ns.store(0, std::memory_order_relaxed);
+  }
+}
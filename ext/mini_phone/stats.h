@@ -0,0 +1,70 @@
+#ifndef MINI_PHONE_STATS_H
+#define MINI_PHONE_STATS_H 1
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Opt-in instrumentation of the native hot paths. While disabled, a timer is
+// a single relaxed load, so the call sites can stay instrumented for good.
+enum StatsPhase {
+  // Copying Ruby strings into std::strings for libphonenumber.
+  STATS_PHASE_INPUT,
+  STATS_PHASE_PARSE,
+  STATS_PHASE_VALIDATE,
+  STATS_PHASE_TYPE,
+  STATS_PHASE_FORMAT,
+  STATS_PHASE_COUNT,
+};
+
+struct StatsCounters {
+  uint64_t calls;
+  uint64_t ns;
+};
+
+extern std::atomic<bool> stats_enabled_flag;
+
+inline bool stats_enabled() { return stats_enabled_flag.load(std::memory_order_relaxed); }
+
+void stats_set_enabled(bool enabled);
+
+inline uint64_t stats_now() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+// Adds a call to the phase, and to the region when one is given. Region codes
+// libphonenumber doesn't know are counted under "ZZ".
+void stats_record(StatsPhase phase, uint64_t ns, const std::string *region_code);
+
+const char *stats_phase_name(StatsPhase phase);
+StatsCounters stats_phase(StatsPhase phase);
+// Indexed like region_code_at.
+StatsCounters stats_region(size_t index);
+void stats_reset();
+
+// Times the enclosing scope. Safe to use without the GVL.
+class StatsTimer {
+public:
+  explicit StatsTimer(StatsPhase phase, const std::string *region_code = nullptr)
+      : phase(phase), region_code(region_code), start(stats_enabled() ? stats_now() : 0) {}
+
+  ~StatsTimer() {
+    if (start != 0) {
+      stats_record(phase, stats_now() - start, region_code);
+    }
+  }
+
+  StatsTimer(const StatsTimer &) = delete;
+  StatsTimer &operator=(const StatsTimer &) = delete;
+
+private:
+  StatsPhase phase;
+  const std::string *region_code;
+  uint64_t start;
+};
+
+#endif /* MINI_PHONE_STATS_H */
@@ -0,0 +1,171 @@
+#include "stream_normalizer.h"
+#include "number_shape.h"
+#include "phonenumbers/phonenumberutil.h"
+#include "region_codes.h"
+#include "stats.h"
+#include <cstring>
+
+using namespace ::i18n::phonenumbers;
+
+// Returns the end of the field starting at `pos`, skipping over separators
+// inside double quotes.
+static inline const char *field_end(const char *pos, const char *end, char separator) {
+  if (pos < end && *pos == '"') {
+    for (pos++; pos < end; pos++) {
+      if (*pos == '"') {
+        if (pos + 1 < end && pos[1] == '"') {
+          pos++;
+        } else {
+          pos++;
+          break;
+        }
+      }
+    }
+  }
+
+  const char *next = static_cast<const char *>(memchr(pos, separator, end - pos));
+
+  return next ? next : end;
+}
+
+static inline void field_value(const char *begin, const char *end, std::string *value) {
+  value->clear();
+
+  if (begin == end || *begin != '"') {
+    value->assign(begin, end);
+    return;
+  }
+
+  for (const char *pos = begin + 1; pos < end; pos++) {
+    if (*pos == '"') {
+      if (pos + 1 < end && pos[1] == '"') {
+        pos++;
+      } else {
+        continue;
+      }
+    }
+
+    value->push_back(*pos);
+  }
+}
+
+static inline void append_field(const std::string &value, char separator, std::string *out) {
+  if (value.find(separator) == std::string::npos && value.find('"') == std::string::npos) {
+    out->append(value);
+    return;
+  }
+
+  out->push_back('"');
+
+  for (char c : value) {
+    if (c == '"') {
+      out->push_back('"');
+    }
+
+    out->push_back(c);
+  }
+
+  out->push_back('"');
+}
+
+void StreamNormalizer::process_line(const char *line, const char *line_end, std::string *out) {
+  const char *content_end = line_end;
+
+  if (content_end > line && content_end[-1] == '\n') {
+    content_end--;
+  }
+
+  if (content_end > line && content_end[-1] == '\r') {
+    content_end--;
+  }
+
+  if (content_end == line) {
+    out->append(line, line_end);
+    return;
+  }
+
+  const char *begin = line;
+
+  for (size_t i = 0; i < column; i++) {
+    begin = field_end(begin, content_end, separator);
+
+    if (begin == content_end) {
+      out->append(line, line_end);
+      return;
+    }
+
+    begin++;
+  }
+
+  const char *end = field_end(begin, content_end, separator);
+  const PhoneNumberUtil &phone_util(*PhoneNumberUtil::GetInstance());
+  PhoneNumber number;
+  uint64_t national_number;
+  bool parsed;
+
+  field_value(begin, end, &value);
+  rows++;
+
+  switch (number_shape(value.data(), value.size(), region_valid_for_parsing, &national_number)) {
+  case NUMBER_SHAPE_JUNK:
+    parsed = false;
+    break;
+  case NUMBER_SHAPE_NANP_E164:
+    number.set_country_code(1);
+    number.set_national_number(national_number);
+    parsed = true;
+    break;
+  default: {
+    StatsTimer timer(STATS_PHASE_PARSE, &region_code);
+    parsed = phone_util.Parse(value, region_code, &number) == PhoneNumberUtil::NO_PARSING_ERROR;
+    break;
+  }
+  }
+
+  out->append(line, begin);
+
+  if (parsed) {
+    number_format(number, style, &formatted);
+    append_field(formatted, separator, out);
+    normalized++;
+  } else {
+    failed++;
+  }
+
+  out->append(end, line_end);
+}
+
+size_t StreamNormalizer::process(const char *data, size_t len, bool final, std::string *out,
+                                 const std::atomic<bool> *stop) {
+  if (!region_checked) {
+    region_valid_for_parsing = region_code_valid_for_parsing(region_code.data(), region_code.size());
+    region_checked = true;
+  }
+
+  const char *pos = data;
+  const char *end = data + len;
+
+  while (pos < end && !stop->load(std::memory_order_relaxed)) {
+    const char *newline = static_cast<const char *>(memchr(pos, '\n', end - pos));
+    const char *line_end;
+
+    if (newline) {
+      line_end = newline + 1;
+    } else if (final) {
+      line_end = end;
+    } else {
+      break;
+    }
+
+    if (headers) {
+      out->append(pos, line_end);
+      headers = false;
+    } else {
+      process_line(pos, line_end, out);
+    }
+
+    pos = line_end;
+  }
+
+  return pos - data;
+}
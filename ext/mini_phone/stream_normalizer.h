@@ -0,0 +1,42 @@
+#ifndef MINI_PHONE_STREAM_NORMALIZER_H
+#define MINI_PHONE_STREAM_NORMALIZER_H 1
+
+#include "number_format.h"
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+// Rewrites one column of delimited text (CSV by default) line by line,
+// replacing each phone number with its formatted version. Numbers which can't
+// be parsed become empty fields; lines that don't have the column are copied
+// as is.
+//
+// Fields may be double quoted (with "" escaping a quote), but a quoted field
+// can't span lines. Line endings, "\n" or "\r\n", are preserved.
+struct StreamNormalizer {
+  size_t column = 0;
+  char separator = ',';
+  bool headers = false;
+  std::string region_code;
+  NumberFormatStyle style = NUMBER_FORMAT_E164;
+
+  size_t rows = 0;
+  size_t normalized = 0;
+  size_t failed = 0;
+
+  // Normalizes the complete lines in `data`, appending them to `out`, and
+  // returns how many bytes were consumed. Unless `final` is set, a trailing
+  // line without a newline is left for the next call. Stops early (at a line
+  // boundary) once `stop` is set. Safe to call without the GVL.
+  size_t process(const char *data, size_t len, bool final, std::string *out, const std::atomic<bool> *stop);
+
+private:
+  bool region_valid_for_parsing = false;
+  bool region_checked = false;
+  std::string value;
+  std::string formatted;
+
+  void process_line(const char *line, const char *line_end, std::string *out);
+};
+
+#endif /* MINI_PHONE_STREAM_NORMALIZER_H */
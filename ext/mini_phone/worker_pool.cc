@@ -0,0 +1,147 @@
+#include "worker_pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+struct WorkerPoolTask {
+  size_t end;
+  size_t chunk_size;
+  std::atomic<size_t> next;
+  std::atomic<bool> *stop;
+  const std::function<void(size_t, size_t)> *fn;
+  size_t helpers_wanted;
+  size_t helpers_active;
+};
+
+// The pool is never destroyed: workers are detached and simply stay parked on
+// the condition variable until the process exits. After a fork the child has
+// none of the parent's threads, so a fresh pool is started (and the old one,
+// including a mutex that may have been held while forking, is abandoned).
+struct WorkerPool {
+  std::mutex mutex;
+  std::condition_variable work_cv;
+  std::condition_variable done_cv;
+  std::list<WorkerPoolTask *> tasks;
+  size_t threads = 0;
+  pid_t pid = getpid();
+};
+
+static std::atomic<WorkerPool *> current_pool{nullptr};
+static std::mutex current_pool_mutex;
+
+static inline bool worker_pool_task_wants_help(WorkerPoolTask *task) {
+  return task->helpers_active < task->helpers_wanted && task->next.load(std::memory_order_relaxed) < task->end &&
+         !task->stop->load(std::memory_order_relaxed);
+}
+
+static void worker_pool_task_work(WorkerPoolTask *task) {
+  while (!task->stop->load(std::memory_order_relaxed)) {
+    size_t begin = task->next.fetch_add(task->chunk_size, std::memory_order_relaxed);
+
+    if (begin >= task->end) {
+      break;
+    }
+
+    (*task->fn)(begin, std::min(begin + task->chunk_size, task->end));
+  }
+}
+
+static void worker_pool_worker(WorkerPool *pool) {
+  std::unique_lock<std::mutex> lock(pool->mutex);
+
+  while (true) {
+    WorkerPoolTask *task = nullptr;
+
+    pool->work_cv.wait(lock, [&] {
+      for (WorkerPoolTask *candidate : pool->tasks) {
+        if (worker_pool_task_wants_help(candidate)) {
+          task = candidate;
+          return true;
+        }
+      }
+
+      return false;
+    });
+
+    task->helpers_active++;
+    lock.unlock();
+    worker_pool_task_work(task);
+    lock.lock();
+
+    if (--task->helpers_active == 0) {
+      pool->done_cv.notify_all();
+    }
+  }
+}
+
+static WorkerPool *worker_pool_get() {
+  WorkerPool *pool = current_pool.load(std::memory_order_acquire);
+
+  if (pool != nullptr && pool->pid == getpid()) {
+    return pool;
+  }
+
+  std::lock_guard<std::mutex> guard(current_pool_mutex);
+  pool = current_pool.load(std::memory_order_relaxed);
+
+  if (pool == nullptr || pool->pid != getpid()) {
+    pool = new WorkerPool();
+    current_pool.store(pool, std::memory_order_release);
+  }
+
+  return pool;
+}
+
+size_t worker_pool_run(size_t begin, size_t end, size_t threads, std::atomic<bool> *stop,
+                       const std::function<void(size_t, size_t)> &fn) {
+  if (begin >= end) {
+    return end;
+  }
+
+  threads = std::max<size_t>(1, std::min(threads, WORKER_POOL_MAX_THREADS));
+
+  size_t size = end - begin;
+  size_t helpers = std::min(threads - 1, size - 1);
+
+  WorkerPoolTask task;
+  task.end = end;
+  task.chunk_size = std::max<size_t>(1, std::min<size_t>(256, size / (threads * 8)));
+  task.next.store(begin, std::memory_order_relaxed);
+  task.stop = stop;
+  task.fn = &fn;
+  task.helpers_wanted = helpers;
+  task.helpers_active = 0;
+
+  if (helpers == 0) {
+    worker_pool_task_work(&task);
+
+    return std::min(task.next.load(std::memory_order_relaxed), end);
+  }
+
+  WorkerPool *pool = worker_pool_get();
+
+  {
+    std::lock_guard<std::mutex> guard(pool->mutex);
+
+    while (pool->threads < helpers) {
+      std::thread(worker_pool_worker, pool).detach();
+      pool->threads++;
+    }
+
+    pool->tasks.push_back(&task);
+  }
+
+  pool->work_cv.notify_all();
+  worker_pool_task_work(&task);
+
+  {
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->tasks.remove(&task);
+    pool->done_cv.wait(lock, [&] { return task.helpers_active == 0; });
+  }
+
+  return std::min(task.next.load(std::memory_order_relaxed), end);
+}
@@ -0,0 +1,21 @@
+#ifndef MINI_PHONE_WORKER_POOL_H
+#define MINI_PHONE_WORKER_POOL_H 1
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+// Upper bound for the `threads:` option of the batch APIs.
+static const size_t WORKER_POOL_MAX_THREADS = 256;
+
+// Runs `fn` over the items in [begin, end), split into chunks which are
+// claimed dynamically by up to `threads` threads (the calling thread included),
+// so slow chunks never hold up idle workers. Must be called without the GVL.
+//
+// Setting `stop` makes every thread finish the chunk it is working on and
+// return. Chunks are always processed in full, so all items before the
+// returned index are done and the work can be resumed from there.
+size_t worker_pool_run(size_t begin, size_t end, size_t threads, std::atomic<bool> *stop,
+                       const std::function<void(size_t, size_t)> &fn);
+
+#endif /* MINI_PHONE_WORKER_POOL_H */
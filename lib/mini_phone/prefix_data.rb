@@ -0,0 +1,128 @@
+# frozen_string_literal: true
+
+module MiniPhone
+  # Compiles libphonenumber's carrier and geocoding prefix files (the
+  # `resources/carrier` and `resources/geocoding` directories of its
+  # repository) into the single file read by `MiniPhone.load_prefix_data`.
+  # The layout is described in ext/mini_phone/prefix_data.h.
+  module PrefixData
+    MAGIC = 'MPPREFIX'
+    VERSION = 1
+    KINDS = { carrier: 0, geocoding: 1 }.freeze
+    MAX_LOCALE_BYTES = 23
+
+    Node = Struct.new(:children, :value, :first_child)
+
+    module_function
+
+    # Writes the data for every locale (or only `locales`) found under
+    # `resources` to `output`, and returns the number of tables and bytes
+    # written.
+    def compile(resources, output, locales: nil)
+      tables = KINDS.flat_map do |kind, id|
+        locale_dirs(resources, kind, locales).map { |dir| [id, File.basename(dir), read_locale(dir)] }
+      end
+
+      { tables: tables.size, bytes: write(tables, output) }
+    end
+
+    def locale_dirs(resources, kind, locales)
+      Dir[File.join(resources, kind.to_s, '*')].sort.select do |dir|
+        File.directory?(dir) && (locales.nil? || locales.include?(File.basename(dir)))
+      end
+    end
+
+    # Builds the trie for every country of a locale, the prefixes in the
+    # files already start with the country calling code.
+    def read_locale(dir)
+      root = Node.new(nil, nil, 0)
+      Dir[File.join(dir, '*.txt')].sort.each { |file| read_file(file, root) }
+      root
+    end
+
+    def read_file(file, root)
+      File.foreach(file, encoding: 'UTF-8') do |line|
+        line = line.strip
+        next if line.empty? || line.start_with?('#')
+
+        prefix, description = line.split('|', 2)
+        raise ArgumentError, "#{file}: bad line #{line.inspect}" unless prefix.match?(/\A\d+\z/) && description
+
+        insert(root, prefix, description)
+      end
+    end
+
+    def insert(root, prefix, description)
+      node = prefix.each_char.reduce(root) do |parent, digit|
+        parent.children ||= Array.new(10)
+        parent.children[digit.ord - 48] ||= Node.new(nil, nil, 0)
+      end
+
+      node.value = description
+    end
+
+    def write(tables, output)
+      nodes = []
+      roots = tables.map { |(_, _, root)| layout(root, nodes) }
+      strings = Strings.new
+      packed_nodes = nodes.map { |node| pack_node(node, strings) }.join
+
+      File.open(output, 'wb') do |file|
+        file.write(MAGIC, [VERSION, tables.size, nodes.size, strings.data.bytesize].pack('L<4'), "\0" * 8)
+        tables.zip(roots) { |(kind, locale, _), root| file.write(pack_table(kind, locale, root)) }
+        file.write(packed_nodes, strings.data)
+      end
+
+      File.size(output)
+    end
+
+    # Appends the trie breadth first, so the children of a node end up next
+    # to each other and the top levels share cache lines. Returns the root.
+    def layout(root, nodes)
+      root_index = nodes.size
+      nodes << root
+      i = root_index
+
+      while i < nodes.size
+        node = nodes[i]
+        node.first_child = nodes.size
+        node.children&.each { |child| nodes << child if child }
+        i += 1
+      end
+
+      root_index
+    end
+
+    def pack_table(kind, locale, root)
+      raise ArgumentError, "locale too long: #{locale}" if locale.bytesize > MAX_LOCALE_BYTES
+
+      [kind, root].pack('L<2') + locale.b.ljust(MAX_LOCALE_BYTES + 1, "\0")
+    end
+
+    def pack_node(node, strings)
+      mask = 0
+      node.children&.each_with_index { |child, digit| mask |= 1 << digit if child }
+      value = node.value.nil? ? 0 : strings.offset(node.value) + 1
+
+      [mask.zero? ? 0 : node.first_child, value, mask, 0].pack('L<L<S<S<')
+    end
+
+    # NUL terminated and deduplicated, starting with the empty string
+    class Strings
+      attr_reader :data
+
+      def initialize
+        @data = +"\0".b
+        @offsets = { '' => 0 }
+      end
+
+      def offset(string)
+        @offsets[string] ||= begin
+          offset = @data.bytesize
+          @data << string.b << "\0"
+          offset
+        end
+      end
+    end
+  end
+end
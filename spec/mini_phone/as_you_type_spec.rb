@@ -0,0 +1,46 @@
+# frozen_string_literal: true
+
+RSpec.describe MiniPhone::AsYouType do
+  let(:formatter) { MiniPhone::AsYouType.new('US') }
+
+  it 'formats the number as it is typed' do
+    results = '6502532222'.each_char.map { |digit| formatter.input_digit(digit) }
+
+    expect(results.values_at(0, 2, 5, -1)).to eq(['6', '650', '650 253', '650 253 2222'])
+    expect(formatter.to_s).to eq('650 253 2222')
+  end
+
+  it 'formats international numbers' do
+    expect(formatter.input('+16502532222')).to eq('+1 650 253 2222')
+  end
+
+  it 'takes back the last character' do
+    formatter.input('6502532222')
+
+    expect(formatter.remove_last).to eq('650 253 222')
+    expect(formatter.input_digit('9')).to eq('650 253 2229')
+  end
+
+  it 'can be cleared and reused' do
+    formatter.input('6502532222')
+
+    expect(formatter.clear.to_s).to eq('')
+    expect(formatter.remove_last).to eq('')
+    expect(formatter.input('6502532222')).to eq('650 253 2222')
+  end
+
+  it 'uses the default country' do
+    MiniPhone.with_default_country('GB') do
+      expect(MiniPhone::AsYouType.new.input('02070313000')).to eq('020 7031 3000')
+    end
+  end
+
+  it 'takes a single character at a time' do
+    expect { formatter.input_digit('65') }.to raise_error(ArgumentError)
+    expect { formatter.input_digit('') }.to raise_error(ArgumentError)
+  end
+
+  it 'reads full width digits' do
+    expect(formatter.input('６５０２５３２２２２')).to eq('650 253 2222')
+  end
+end
@@ -0,0 +1,40 @@
+# frozen_string_literal: true
+
+RSpec.describe MiniPhone::Matcher do
+  let(:references) { ['+1 404-384-1384', MiniPhone::PhoneNumber.new('+44 1434 634996'), 'foo'] }
+  let(:matcher) { MiniPhone::Matcher.new(references, 'US') }
+
+  it 'indexes the numbers which can be parsed' do
+    expect(matcher.size).to eq(2)
+  end
+
+  it 'returns the best match level per candidate' do
+    candidates = [
+      '+1 404 384 1384',
+      '(404) 384-1384',
+      '+1 404 384 1384 ext. 5',
+      '384-1384',
+      MiniPhone::PhoneNumber.new('+441434634996'),
+      '+49 30 1234567',
+      'foo',
+      nil
+    ]
+
+    expect(matcher.match(candidates)).to eq(
+      [:exact_match, :nsn_match, :short_nsn_match, :short_nsn_match, :exact_match, nil, nil, nil]
+    )
+  end
+
+  it 'agrees with PhoneNumber#== on exact matches' do
+    references = Array.new(200) { |i| "+1 404 555 #{format('%04d', i)}" }
+    candidates = Array.new(400) { |i| "+1 404 555 #{format('%04d', i)}" }
+    matcher = MiniPhone::Matcher.new(references, threads: 2)
+
+    expected = candidates.map do |candidate|
+      pn = MiniPhone.parse(candidate)
+      references.any? { |reference| MiniPhone.parse(reference) == pn } ? :exact_match : nil
+    end
+
+    expect(matcher.match(candidates, threads: 4)).to eq(expected)
+  end
+end
@@ -0,0 +1,90 @@
+# frozen_string_literal: true
+
+RSpec.describe MiniPhone::NumberSet do
+  describe '#add' do
+    it 'adds each number once' do
+      set = MiniPhone::NumberSet.new('US')
+
+      expect(set.add('(404) 384-1384')).to eq(true)
+      expect(set.add('+1 404 384 1384')).to eq(false)
+      expect(set.add(MiniPhone::PhoneNumber.new('+14043841384'))).to eq(false)
+      expect(set.add(4_043_841_385)).to eq(true)
+      expect(set.size).to eq(2)
+    end
+
+    it 'ignores numbers which cannot be parsed' do
+      set = MiniPhone::NumberSet.new
+
+      expect(set.add('foo')).to be_nil
+      expect(set.add(nil)).to be_nil
+      expect(set.size).to eq(0)
+    end
+  end
+
+  describe '#add_all' do
+    it 'returns how many numbers were new' do
+      set = MiniPhone::NumberSet.new(:US)
+      set.add('+14043841384')
+
+      numbers = ['404-384-1384', '404-384-1385', '+1 404 384 1385', 'foo', nil,
+                 MiniPhone::PhoneNumber.new('+44 1434 634996'), '+44 1434 634996 ext. 1']
+
+      expect(set.add_all(numbers, threads: 2)).to eq(3)
+      expect(set.size).to eq(4)
+    end
+
+    it 'dedupes large lists' do
+      set = MiniPhone::NumberSet.new('US')
+      numbers = Array.new(20_000) { |i| "+1 404 555 #{format('%04d', i % 5_000)}" }
+
+      expect(set.add_all(numbers, threads: 4)).to eq(5_000)
+      expect(set.include?('(404) 555-4999')).to eq(true)
+      expect(set.include?('(404) 555-5000')).to eq(false)
+    end
+  end
+
+  describe 'numbers with extensions' do
+    it 'keeps every distinct extension' do
+      set = MiniPhone::NumberSet.new('US')
+      numbers = Array.new(10_000) { |i| "+1 404 384 1384 ext. #{i}" }
+
+      expect(set.add_all(numbers, threads: 2)).to eq(10_000)
+      expect(set.add('+1 404 384 1384 ext. 9999')).to eq(false)
+      expect(set.include?('+1 404 384 1384 ext. 10000')).to eq(false)
+      expect(set.include?('+1 404 384 1384')).to eq(false)
+    end
+
+    it 'treats an empty extension like no extension' do
+      set = MiniPhone::NumberSet.new
+      pn = MiniPhone::PhoneNumber.new('+14043841384')
+      packed = pn.to_packed
+      set.add(pn)
+
+      expect(set.add(MiniPhone::PhoneNumber.from_packed("#{(packed.getbyte(0) | 4).chr}#{packed.byteslice(1..)}\x00")))
+        .to eq(false)
+    end
+  end
+
+  describe '#include?' do
+    it 'checks by canonical number' do
+      set = MiniPhone::NumberSet.new('GB')
+      set.add('07911 123456')
+
+      expect(set.include?('+44 7911 123456')).to eq(true)
+      expect(set.include?(MiniPhone::PhoneNumber.new('+447911123456'))).to eq(true)
+      expect(set.include?('+44 7911 123457')).to eq(false)
+      expect(set.include?('foo')).to eq(false)
+    end
+  end
+
+  describe '#clear' do
+    it 'empties the set' do
+      set = MiniPhone::NumberSet.new
+      set.add('+14043841384')
+      set.clear
+
+      expect(set.size).to eq(0)
+      expect(set.include?('+14043841384')).to eq(false)
+    end
+  end
+end
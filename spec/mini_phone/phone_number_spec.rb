@@ -22,6 +22,13 @@ RSpec.describe MiniPhone::PhoneNumber do
       expect(pn.region_code).to eql('GB')
     end
 
+    it 'accepts a symbol region code' do
+      pn = MiniPhone::PhoneNumber.new('7911 123456', :GB)
+
+      expect(pn.region_code).to eql('GB')
+      expect(pn.valid?).to eq(true)
+    end
+
     it 'can be initialized with a fixnum' do
       pn = MiniPhone::PhoneNumber.new(4_043_841_384, 'US')
 
@@ -130,6 +137,10 @@ RSpec.describe MiniPhone::PhoneNumber do
     it 'formats the number' do
       expect(valid_phone_number.raw_national).to eq('4043841384')
     end
+
+    it 'keeps leading zeros' do
+      expect(MiniPhone::PhoneNumber.new('+39 06 1234 5678').raw_national).to eq('0612345678')
+    end
   end
 
   describe '#raw_international' do
@@ -146,6 +157,15 @@ RSpec.describe MiniPhone::PhoneNumber do
     it 'formats the number' do
       expect(valid_phone_number.dasherized_national).to eq('404-384-1384')
     end
+
+    it 'uses the digit groups of the region' do
+      expect(MiniPhone::PhoneNumber.new('+44 1434 634996').dasherized_national).to eq('1434-634996')
+      expect(MiniPhone::PhoneNumber.new('+44 20 7946 0958').dasherized_national).to eq('20-7946-0958')
+    end
+
+    it 'keeps the extension' do
+      expect(MiniPhone::PhoneNumber.new('+1 404-384-1384 ext. 12').dasherized_national).to eq('404-384-1384 ext. 12')
+    end
   end
 
   describe '#dasherized_international' do
@@ -154,6 +174,10 @@ RSpec.describe MiniPhone::PhoneNumber do
     it 'formats the number' do
       expect(valid_phone_number.dasherized_international).to eq('1-404-384-1384')
     end
+
+    it 'uses the digit groups of the region' do
+      expect(MiniPhone::PhoneNumber.new('+44 1434 634996').dasherized_international).to eq('44-1434-634996')
+    end
   end
 
   describe '#international' do
@@ -178,6 +202,13 @@ RSpec.describe MiniPhone::PhoneNumber do
     it 'specifies the country code' do
       expect(valid_phone_number.region_code).to eq('US')
     end
+
+    it 'returns a shared frozen string' do
+      other = MiniPhone::PhoneNumber.new('+14043841385')
+
+      expect(valid_phone_number.region_code).to be_frozen
+      expect(valid_phone_number.region_code).to equal(other.region_code)
+    end
   end
 
   describe '#country' do
@@ -270,7 +301,7 @@ RSpec.describe MiniPhone::PhoneNumber do
 
   context 'with a nil phone number' do
     (MiniPhone::PhoneNumber.instance_methods(false) - %i[valid? eql? == valid? invalid? possible?
-                                                         impossible? to_s]).each do |method_name|
+                                                         impossible? to_s hash]).each do |method_name|
       describe method_name do
         it 'returns nil' do
           pn = MiniPhone::PhoneNumber.new(nil)
@@ -290,6 +321,47 @@ RSpec.describe MiniPhone::PhoneNumber do
     end
   end
 
+  it 'memoizes without instance variables' do
+    pn = MiniPhone::PhoneNumber.new('+1 404 384 1384', 'US')
+    %i[e164 national raw_international dasherized_international type area_code valid? possible?].each do |name|
+      pn.public_send(name)
+    end
+
+    expect(pn.instance_variables).to be_empty
+  end
+
+  it 'keeps memoized values alive across GC' do
+    pn = MiniPhone::PhoneNumber.new('+1 404 384 1384')
+    pn.e164
+    pn.region_code
+    GC.start
+    GC.compact if GC.respond_to?(:compact)
+
+    expect(pn.e164).to eq('+14043841384')
+    expect(pn.region_code).to eq('US')
+  end
+
+  it 'recycles freed numbers' do
+    MiniPhone::PhoneNumber.new('+1 404 384 1384').e164
+    GC.start
+    pn = MiniPhone::PhoneNumber.new('+44 1434 634996')
+
+    expect(MiniPhone::PhoneNumber.pool_stats[:recycled]).to be > 0
+    expect(pn.e164).to eq('+441434634996')
+    expect(pn.to_s).to eq('+44 1434 634996')
+    expect(pn.valid?).to eq(true)
+  end
+
+  it 'does not reuse stale values from recycled numbers' do
+    100.times { MiniPhone::PhoneNumber.new('+1 404 384 1384').e164 }
+    GC.start
+
+    pn = MiniPhone::PhoneNumber.new('aaaa')
+
+    expect(pn.e164).to be_nil
+    expect(pn.to_s).to eq('')
+  end
+
   it 'has an accurate mem_size' do
     require 'objspace'
 
@@ -297,4 +369,169 @@ RSpec.describe MiniPhone::PhoneNumber do
 
     expect(ObjectSpace.memsize_of(pn)).to be >= 128
   end
+
+  describe '#to_packed' do
+    it 'round trips through from_packed' do
+      pn = MiniPhone::PhoneNumber.new('+1 404 384 1384')
+      packed = pn.to_packed
+      loaded = MiniPhone::PhoneNumber.from_packed(packed)
+
+      expect(packed.bytesize).to be <= 8
+      expect(loaded.e164).to eq('+14043841384')
+      expect(loaded.to_s).to eq('+14043841384')
+      expect(loaded).to eq(pn)
+    end
+
+    it 'keeps extensions, leading zeros and optionally the raw input' do
+      pn = MiniPhone::PhoneNumber.new('+39 02 1234 5678 ext. 123')
+      loaded = MiniPhone::PhoneNumber.from_packed(pn.to_packed(raw_input: true))
+
+      expect(loaded.to_s).to eq('+39 02 1234 5678 ext. 123')
+      expect(loaded.e164).to eq(pn.e164)
+      expect(loaded.international).to eq(pn.international)
+    end
+
+    it 'uses the region code given to from_packed' do
+      pn = MiniPhone::PhoneNumber.from_packed(MiniPhone::PhoneNumber.new('7911 123456', 'GB').to_packed, :GB)
+
+      expect(pn.valid?).to eq(true)
+      expect(pn.national).to eq('07911 123456')
+    end
+
+    it 'rejects malformed input' do
+      packed = MiniPhone::PhoneNumber.new('+14043841384').to_packed
+
+      expect { MiniPhone::PhoneNumber.from_packed(packed[0..-2]) }.to raise_error(ArgumentError)
+      expect { MiniPhone::PhoneNumber.from_packed('') }.to raise_error(ArgumentError)
+    end
+  end
+
+  describe '#to_packed_int' do
+    it 'round trips through from_packed' do
+      pn = MiniPhone::PhoneNumber.new('+39 02 1234 5678')
+      packed = pn.to_packed_int
+
+      expect(packed).to be_between(0, 2**63 - 1)
+      expect(MiniPhone::PhoneNumber.from_packed(packed).international).to eq(pn.international)
+    end
+
+    it 'returns nil when the number does not fit' do
+      expect(MiniPhone::PhoneNumber.new('+1 404 384 1384 ext. 12').to_packed_int).to be_nil
+    end
+
+    it 'rejects malformed input' do
+      expect { MiniPhone::PhoneNumber.from_packed(0) }.to raise_error(ArgumentError)
+      expect { MiniPhone::PhoneNumber.from_packed(-1) }.to raise_error(ArgumentError)
+    end
+
+    it 'raises ArgumentError for integers wider than 64 bits' do
+      expect { MiniPhone::PhoneNumber.from_packed(2**64) }.to raise_error(ArgumentError, 'invalid packed phone number')
+      expect { MiniPhone::PhoneNumber.from_packed(-2**64) }.to raise_error(ArgumentError, 'invalid packed phone number')
+    end
+
+    it 'rejects country codes above 999' do
+      expect { MiniPhone::PhoneNumber.from_packed((1000 << 50) | 4_043_841_384) }.to raise_error(ArgumentError)
+      expect { MiniPhone::PhoneNumber.from_packed((1023 << 50) | 4_043_841_384) }.to raise_error(ArgumentError)
+      expect(MiniPhone::PhoneNumber.from_packed((999 << 50) | 4_043_841_384).country_code).to eq(999)
+    end
+  end
+
+  describe '#hash and #eql?' do
+    it 'treats different spellings of the same number as equal' do
+      a = MiniPhone::PhoneNumber.new('+1 404-384-1384')
+      b = MiniPhone::PhoneNumber.new('(404) 384 1384', 'US')
+
+      expect(a).to eql(b)
+      expect(a.hash).to eq(b.hash)
+      expect([a, b].uniq.size).to eq(1)
+      expect({ a => 1 }[b]).to eq(1)
+    end
+
+    it 'tells numbers apart by country code and extension' do
+      us = MiniPhone::PhoneNumber.new('+1 404-384-1384')
+
+      expect(us).not_to eql(MiniPhone::PhoneNumber.new('+44 404-384-1384'))
+      expect(us).not_to eql(MiniPhone::PhoneNumber.new('+1 404-384-1384 ext. 1'))
+      with_extension = MiniPhone::PhoneNumber.new('+1 404-384-1384 ext. 1')
+
+      expect(with_extension).to eql(MiniPhone::PhoneNumber.new('+14043841384;ext=1'))
+    end
+
+    it 'treats an empty extension like no extension' do
+      pn = MiniPhone::PhoneNumber.new('+14043841384')
+      packed = pn.to_packed
+      empty_extension = MiniPhone::PhoneNumber.from_packed("#{(packed.getbyte(0) | 4).chr}#{packed.byteslice(1..)}\x00")
+
+      expect(empty_extension).to eql(pn)
+      expect(empty_extension.hash).to eq(pn.hash)
+    end
+
+    it 'tells apart numbers which only differ in a long extension' do
+      a = MiniPhone::PhoneNumber.new('+1 404-384-1384 ext. 12345')
+      b = MiniPhone::PhoneNumber.new('+1 404-384-1384 ext. 12346')
+
+      expect(a).not_to eql(b)
+      expect(Array.new(1_000) { |i| MiniPhone::PhoneNumber.new("+1 404-384-1384 ext. #{i}") }.uniq.size).to eq(1_000)
+    end
+
+    it 'compares numbers which could not be parsed by their input' do
+      expect(MiniPhone::PhoneNumber.new('foo')).to eql(MiniPhone::PhoneNumber.new('foo'))
+      expect(MiniPhone::PhoneNumber.new('foo').hash).to eq(MiniPhone::PhoneNumber.new('foo').hash)
+      expect(MiniPhone::PhoneNumber.new('foo')).not_to eql(MiniPhone::PhoneNumber.new('bar'))
+    end
+  end
+
+  describe '#carrier and #location' do
+    before(:all) do
+      require 'mini_phone/prefix_data'
+      require 'fileutils'
+      require 'tmpdir'
+
+      @dir = Dir.mktmpdir
+      {
+        'carrier/en/1.txt' => "# Carriers\n1404384|Example Wireless\n",
+        'geocoding/en/1.txt' => "1404|Atlanta, GA\n1404384|Midtown Atlanta, GA\n",
+        'geocoding/en/44.txt' => "441434|Hexham\n",
+        'geocoding/de/1.txt' => "1404|Atlanta, Georgia\n"
+      }.each do |path, contents|
+        FileUtils.mkdir_p(File.dirname(File.join(@dir, path)))
+        File.write(File.join(@dir, path), contents)
+      end
+
+      MiniPhone::PrefixData.compile(@dir, File.join(@dir, 'prefix_data.bin'))
+      @info = MiniPhone.load_prefix_data(File.join(@dir, 'prefix_data.bin'))
+    end
+
+    after(:all) { FileUtils.remove_entry(@dir) }
+
+    it 'loads the compiled data' do
+      expect(@info[:carrier]).to eq(['en'])
+      expect(@info[:geocoding]).to eq(%w[de en])
+      expect(MiniPhone.prefix_data).to eq(@info)
+    end
+
+    it 'looks up the longest prefix' do
+      expect(valid_phone_number.location).to eq('Midtown Atlanta, GA')
+      expect(valid_phone_number.carrier).to eq('Example Wireless')
+      expect(MiniPhone::PhoneNumber.new('+1 404-555-1384').location).to eq('Atlanta, GA')
+    end
+
+    it 'falls back to English' do
+      expect(valid_phone_number.location('de')).to eq('Atlanta, Georgia')
+      expect(MiniPhone::PhoneNumber.new('+44 1434 634996').location(:de_CH)).to eq('Hexham')
+    end
+
+    it 'only has a carrier for mobile numbers' do
+      number = MiniPhone::PhoneNumber.new('+44 1434 634996')
+
+      expect(number.location).to eq('Hexham')
+      expect(number.carrier).to be_nil
+      expect(MiniPhone::PhoneNumber.new('foo').location).to be_nil
+    end
+
+    it 'keeps the loaded data when a file cannot be loaded' do
+      expect { MiniPhone.load_prefix_data(File.join(@dir, 'carrier/en/1.txt')) }.to raise_error(IOError)
+      expect(MiniPhone.prefix_data).to eq(@info)
+    end
+  end
 end
@@ -53,6 +53,21 @@ RSpec.describe MiniPhone do
 
       expect(result).to eql(true)
     end
+
+    it 'handles the non-geographical region code' do
+      expect(MiniPhone.valid_for_country?('+800 1234 5678', '001')).to eql(true)
+    end
+
+    it 'accepts symbols as region codes' do
+      expect(MiniPhone.valid_for_country?('4043841384', :US)).to eql(true)
+      expect(MiniPhone.valid_for_country?('4043841384', :GB)).to eql(false)
+    end
+
+    it 'treats unknown region codes as invalid regions' do
+      expect(MiniPhone.valid_for_country?('4043841384', 'XX')).to eql(false)
+      expect(MiniPhone.valid_for_country?('4043841384', 'us')).to eql(false)
+      expect(MiniPhone.valid_for_country?('4043841384', 'USA')).to eql(false)
+    end
   end
 
   describe '.invalid_for_country?' do
@@ -128,6 +143,133 @@ RSpec.describe MiniPhone do
 
       expect(MiniPhone.default_country).to eql('ZZ')
     end
+
+    it 'keeps codes outside the region table alive across GCs' do
+      100.times { |i| MiniPhone.default_country = "Q#{i}" }
+      GC.start
+      GC.compact if GC.respond_to?(:compact)
+
+      expect(MiniPhone.default_country).to eq('Q99')
+    end
+
+    it 'accepts a symbol' do
+      MiniPhone.default_country = :US
+
+      expect(MiniPhone.default_country).to eql('US')
+      expect(MiniPhone.valid?('4043841384')).to eq(true)
+    end
+
+    it 'does not keep a reference to the given string' do
+      code = +'US'
+      MiniPhone.default_country = code
+      code.replace('NZ')
+
+      expect(MiniPhone.default_country).to eql('US')
+    end
+
+    it 'returns a frozen string' do
+      MiniPhone.default_country = +'XX'
+
+      expect(MiniPhone.default_country).to eql('XX')
+      expect(MiniPhone.default_country).to be_frozen
+    end
+  end
+
+  describe '.with_default_country' do
+    it 'overrides the default country within the block' do
+      expect(MiniPhone.valid?('4043841384')).to eq(false)
+
+      result = MiniPhone.with_default_country('US') do
+        expect(MiniPhone.default_country).to eql('US')
+        MiniPhone.valid?('4043841384')
+      end
+
+      expect(result).to eq(true)
+      expect(MiniPhone.default_country).to eql('ZZ')
+    end
+
+    it 'can be nested' do
+      MiniPhone.with_default_country(:GB) do
+        MiniPhone.with_default_country('US') do
+          expect(MiniPhone.e164('404-384-1384')).to eq('+14043841384')
+        end
+
+        expect(MiniPhone.e164('01434 634996')).to eq('+441434634996')
+      end
+    end
+
+    it 'restores the default country when the block raises' do
+      expect { MiniPhone.with_default_country('US') { raise 'boom' } }.to raise_error('boom')
+
+      expect(MiniPhone.default_country).to eql('ZZ')
+    end
+
+    it 'only applies to the current thread' do
+      MiniPhone.with_default_country('US') do
+        expect(Thread.new { MiniPhone.default_country }.value).to eql('ZZ')
+      end
+    end
+
+    it 'requires a block' do
+      expect { MiniPhone.with_default_country('US') }.to raise_error(LocalJumpError)
+    end
+  end
+
+  describe 'Ractor support' do
+    it 'can validate numbers from a Ractor' do
+      skip 'Ractor is not available' unless defined?(Ractor)
+
+      experimental = Warning[:experimental]
+      Warning[:experimental] = false
+      ractor = Ractor.new do
+        MiniPhone.with_default_country('US') { [MiniPhone.valid?('4043841384'), MiniPhone.e164('404-384-1384')] }
+      end
+
+      expect(ractor.respond_to?(:value) ? ractor.value : ractor.take).to eq([true, '+14043841384'])
+    ensure
+      Warning[:experimental] = experimental unless experimental.nil?
+    end
+
+    it 'supports the rest of the API from a Ractor' do
+      skip 'Ractor is not available' unless defined?(Ractor)
+
+      experimental = Warning[:experimental]
+      Warning[:experimental] = false
+      ractor = Ractor.new do
+        pn = MiniPhone.parse('+1 404-384-1384')
+        set = MiniPhone::NumberSet.new('US')
+        set.add_all(['404-384-1384', '+14043841384', '+44 1434 634996 ext. 1'], threads: 2)
+
+        [pn.valid?, pn.national, MiniPhone::PhoneNumber.from_packed(pn.to_packed(raw_input: true)).to_s,
+         MiniPhone.e164_many(['404-384-1384', 'foo'], 'US', threads: 2),
+         MiniPhone.parse_columns(['+14043841384'], fields: %i[e164 country_code])[:e164],
+         MiniPhone.normalize('404-384-1384', 'US', format: :national),
+         MiniPhone.find_numbers('Call +1 404-384-1384', 'US', leniency: :valid).map(&:raw_string),
+         set.size, MiniPhone.normalize_digits_many(['٤٠٤', '+1 404'])]
+      end
+
+      expect(ractor.respond_to?(:value) ? ractor.value : ractor.take).to eq(
+        [true, '(404) 384-1384', '+1 404-384-1384', ['+14043841384', nil], ['+14043841384'], '(404) 384-1384',
+         ['+1 404-384-1384'], 2, %w[404 1404]]
+      )
+    ensure
+      Warning[:experimental] = experimental unless experimental.nil?
+    end
+
+    it 'shares the default country between Ractors' do
+      skip 'Ractor is not available' unless defined?(Ractor)
+
+      experimental = Warning[:experimental]
+      Warning[:experimental] = false
+      previous = MiniPhone.default_country
+      ractor = Ractor.new { MiniPhone.default_country = 'GB' }
+
+      ractor.respond_to?(:value) ? ractor.value : ractor.take
+      expect(MiniPhone.default_country).to eq('GB')
+    ensure
+      MiniPhone.default_country = previous
+      Warning[:experimental] = experimental unless experimental.nil?
+    end
   end
 
   describe '.normalize_digits_only' do
@@ -138,5 +280,515 @@ RSpec.describe MiniPhone do
     it 'normalizes phone numbers' do
       expect(MiniPhone.normalize_digits_only('034-56&+a#234')).to eq('03456234')
     end
+
+    it 'normalizes long ASCII input' do
+      input = "#{'1' * 40}-#{'2' * 40}"
+
+      expect(MiniPhone.normalize_digits_only(input)).to eq(input.delete('-'))
+    end
+
+    it 'normalizes full-width and Arabic-Indic digits' do
+      expect(MiniPhone.normalize_digits_only('＋１ (４０４) ３８４-１３８４')).to eq('14043841384')
+      expect(MiniPhone.normalize_digits_only('+1 ٤٠٤ 384 ١٣٨٤')).to eq('14043841384')
+    end
+
+    it 'writes into the given buffer' do
+      buffer = +'previous contents'
+      result = MiniPhone.normalize_digits_only('+1 (404) 384-1384', buffer)
+
+      expect(result).to equal(buffer)
+      expect(buffer).to eq('14043841384')
+      expect(MiniPhone.normalize_digits_only('＋４４', buffer)).to eq('44')
+    end
+
+    it 'can normalize a string into itself' do
+      number = +'+1 404 ٣٨٤ 1384'
+
+      expect(MiniPhone.normalize_digits_only(number, number)).to eq('14043841384')
+    end
+
+    it 'raises for a frozen buffer' do
+      expect { MiniPhone.normalize_digits_only('404', 'frozen') }.to raise_error(FrozenError)
+    end
+
+    it 'raises for a buffer with an encoding that is not ASCII compatible' do
+      buffer = 'previous'.encode('UTF-16LE')
+
+      expect { MiniPhone.normalize_digits_only('404', buffer) }.to raise_error(Encoding::CompatibilityError)
+      expect(buffer).to eq('previous'.encode('UTF-16LE'))
+    end
+  end
+
+  describe '.normalize_digits_many' do
+    it 'normalizes every string in the array' do
+      result = MiniPhone.normalize_digits_many(['+1 404-384-1384', nil, '＋４４ １４３４', 'a٤٠٤'])
+
+      expect(result).to eq(['14043841384', nil, '441434', '404'])
+    end
+
+    it 'gives the same results for any number of threads' do
+      numbers = Array.new(5_000) { |i| i.even? ? "+1 (404) 384-#{format('%04d', i)}" : "٤٠٤-#{i}" }
+      expected = numbers.map { |n| MiniPhone.normalize_digits_only(n) }
+
+      [1, 2, 7].each do |threads|
+        expect(MiniPhone.normalize_digits_many(numbers, threads: threads)).to eq(expected)
+      end
+    end
+  end
+
+  describe '.valid_many?' do
+    it 'validates every number in the array' do
+      result = MiniPhone.valid_many?(['+14043841384', '-12', '+44 1434 634996'])
+
+      expect(result).to eq([true, false, true])
+    end
+
+    it 'accepts a country code' do
+      result = MiniPhone.valid_many?(['4043841384', '+44 1434 634996'], 'US')
+
+      expect(result).to eq([true, false])
+    end
+
+    it 'handles nil and non-string values' do
+      expect(MiniPhone.valid_many?([nil, :foo, 4_043_841_384], 'US')).to eq([false, false, true])
+    end
+
+    it 'handles an empty array' do
+      expect(MiniPhone.valid_many?([])).to eq([])
+    end
+
+    it 'agrees with .valid_for_country?' do
+      numbers = ['4043841384', '444', '(404) 384-1399', '+1 404 384 1384', 'aaaa', '7911 123456']
+
+      expect(MiniPhone.valid_many?(numbers, 'US')).to eq(numbers.map { |n| MiniPhone.valid_for_country?(n, 'US') })
+    end
+  end
+
+  describe '.parse_many' do
+    it 'returns MiniPhone::PhoneNumber instances' do
+      result = MiniPhone.parse_many(['+14043841384', '4043841385'], 'US')
+
+      expect(result.map(&:e164)).to eq(['+14043841384', '+14043841385'])
+      expect(result.map(&:region_code)).to eq(%w[US US])
+    end
+
+    it 'handles invalid and nil numbers' do
+      invalid, nothing = MiniPhone.parse_many(['aaaa', nil])
+
+      expect(invalid.e164).to be_nil
+      expect(invalid.to_s).to eq('')
+      expect(nothing.valid?).to eq(false)
+    end
+  end
+
+  describe '.parse_columns' do
+    let(:numbers) { ['404-384-1384', 'aaaa', nil, '+44 1434 634996'] }
+
+    it 'returns the requested fields as columns' do
+      columns = MiniPhone.parse_columns(numbers, 'US', fields: %i[e164 national country_code type valid parsed])
+
+      expect(columns.keys).to eq(%i[e164 national country_code type valid parsed])
+      expect(columns[:e164]).to eq(['+14043841384', nil, nil, '+441434634996'])
+      expect(columns[:national]).to eq(['(404) 384-1384', nil, nil, '01434 634996'])
+      expect(columns[:country_code].unpack('S<*')).to eq([1, 0, 0, 44])
+      expect(columns[:type].unpack('C*').map { |type| MiniPhone::TYPES[type] })
+        .to eq(%i[fixed_line_or_mobile unknown unknown fixed_line])
+      expect(columns[:valid].unpack1('b*')[0, 4]).to eq('1000')
+      expect(columns[:parsed].unpack1('b*')[0, 4]).to eq('1001')
+    end
+
+    it 'agrees with the PhoneNumber accessors' do
+      numbers = Array.new(500) { |i| i.even? ? "+1 404 384 #{format('%04d', i)}" : "0#{i}" }
+      columns = MiniPhone.parse_columns(numbers, 'GB', threads: 4)
+      parsed = numbers.map { |n| MiniPhone.parse(n, 'GB') }
+
+      expect(columns[:e164]).to eq(parsed.map(&:e164))
+      expect(columns[:type].unpack('C*').map { |type| MiniPhone::TYPES[type] }).to eq(parsed.map(&:type))
+      expect(columns[:valid].unpack1('b*')[0, 500].chars.map { |bit| bit == '1' }).to eq(parsed.map(&:valid?))
+    end
+
+    it 'rejects unknown fields' do
+      expect { MiniPhone.parse_columns(numbers, fields: [:foo]) }.to raise_error(ArgumentError, /foo/)
+      expect { MiniPhone.parse_columns(numbers, fields: ['e164']) }.to raise_error(TypeError)
+    end
+  end
+
+  describe '.e164_many' do
+    it 'formats every number in the array' do
+      result = MiniPhone.e164_many(['404-384-1384', 'aaaa', nil, '+44 1434 634996'], 'US')
+
+      expect(result).to eq(['+14043841384', nil, nil, '+441434634996'])
+    end
+
+    it 'gives the same results for any number of threads' do
+      numbers = Array.new(5_000) { |i| "404-384-#{format('%04d', i)}" }
+      expected = numbers.map { |n| MiniPhone.parse(n, 'US').e164 }
+
+      [1, 2, 7, 16].each do |threads|
+        expect(MiniPhone.e164_many(numbers, 'US', threads: threads)).to eq(expected)
+      end
+    end
+  end
+
+  describe 'threads: option' do
+    let(:numbers) { Array.new(2_000) { |i| i.even? ? "+1404384#{format('%04d', i)}" : '444' } }
+
+    it 'validates in parallel' do
+      expect(MiniPhone.valid_many?(numbers, threads: 4)).to eq(MiniPhone.valid_many?(numbers))
+    end
+
+    it 'parses in parallel' do
+      expect(MiniPhone.parse_many(numbers, threads: 4).map(&:e164)).to eq(MiniPhone.parse_many(numbers).map(&:e164))
+    end
+
+    it 'rejects an invalid thread count' do
+      expect { MiniPhone.valid_many?(numbers, threads: 0) }.to raise_error(ArgumentError)
+    end
+  end
+
+  describe '.cache_size=' do
+    around do |ex|
+      MiniPhone.cache_size = 2
+      MiniPhone.clear_cache
+      ex.run
+    ensure
+      MiniPhone.cache_size = 0
+      MiniPhone.clear_cache
+    end
+
+    it 'is disabled by default' do
+      MiniPhone.cache_size = 0
+      MiniPhone.valid?('+14043841384')
+
+      expect(MiniPhone.cache_stats).to include(hits: 0, misses: 0, size: 0, capacity: 0)
+    end
+
+    it 'caches parsed numbers' do
+      3.times { MiniPhone.valid?('+14043841384') }
+      pn = MiniPhone.parse('+14043841384')
+
+      expect(pn.e164).to eq('+14043841384')
+      expect(pn.to_s).to eq('+14043841384')
+      expect(MiniPhone.cache_stats).to include(hits: 3, misses: 1, size: 1)
+    end
+
+    it 'keys the cache by region' do
+      expect(MiniPhone.valid_for_country?('4043841384', 'US')).to eq(true)
+      expect(MiniPhone.valid_for_country?('4043841384', 'GB')).to eq(false)
+      expect(MiniPhone.cache_stats).to include(misses: 2, size: 2)
+    end
+
+    it 'evicts the least recently used number' do
+      MiniPhone.valid?('+14043841384')
+      MiniPhone.valid?('+14043841385')
+      MiniPhone.valid?('+14043841384')
+      MiniPhone.valid?('+14043841386')
+      MiniPhone.valid?('+14043841384')
+
+      expect(MiniPhone.cache_stats).to include(hits: 2, misses: 3, evictions: 1, size: 2)
+    end
+
+    it 'caches invalid numbers' do
+      2.times { expect(MiniPhone.parse('aaaa').e164).to be_nil }
+    end
+
+    it 'gives the same results as the uncached batch methods' do
+      numbers = ['+14043841384', '444', '+14043841384', '+44 1434 634996']
+
+      expect(MiniPhone.e164_many(numbers, threads: 2)).to eq(['+14043841384', nil, '+14043841384', '+441434634996'])
+    end
+  end
+
+  describe '.clear_cache' do
+    it 'empties the cache and resets the stats' do
+      MiniPhone.cache_size = 10
+      MiniPhone.valid?('+14043841384')
+      MiniPhone.clear_cache
+
+      expect(MiniPhone.cache_stats).to include(hits: 0, misses: 0, evictions: 0, size: 0, capacity: 10)
+    ensure
+      MiniPhone.cache_size = 0
+    end
+  end
+
+  describe 'fast path validation' do
+    inputs = [
+      '+14043841384', '+12423570000', '+10043841384', '+11043841384', '+1404384138', '+140438413845',
+      '+1 404 384 1384', '4043841384', '14043841384', '444', '4', '', 'a', 'aaaa', '+', '+1', '1-800-FLOWERS',
+      '+44 1434 634996', '01434 634996', 'tel:+1-404-384-1384', '＋１４０４３８４１３８４', '٤٠٤٣٨٤١٣٨٤',
+      "#{'a' * 40}+14043841384", '+1404384138x', '+14043841384 ext. 12'
+    ]
+    random = Random.new(42)
+    alphabet = ['0'..'9', ['+', ' ', '-', '(', ')', 'x', 'a']].flat_map(&:to_a)
+    200.times { inputs << Array.new(random.rand(1..16)) { alphabet.sample(random: random) }.join }
+
+    %w[US GB BS ZZ 001 XX].each do |region|
+      it "agrees with a full parse for #{region}" do
+        inputs.each do |input|
+          expect(MiniPhone.valid_for_country?(input, region)).to eq(MiniPhone.parse(input, region).valid?), input
+        end
+      end
+    end
+  end
+
+  describe '.normalize_stream' do
+    let(:csv) { "name,phone\nbob,(404) 384-1384\r\nann,\"404 384, 1385\"\ncid,foo\n\nshort\n" }
+
+    it 'formats the column of every line' do
+      output = StringIO.new
+      stats = MiniPhone.normalize_stream(StringIO.new(csv), output, column: 1, country: 'US', headers: true)
+
+      expect(output.string).to eq("name,phone\nbob,+14043841384\r\nann,+14043841385\ncid,\n\nshort\n")
+      expect(stats).to include(rows: 3, normalized: 2, failed: 1, bytes_read: csv.bytesize)
+      expect(stats[:rows_per_sec]).to be_a(Float)
+    end
+
+    it 'supports the other formats and separators' do
+      output = StringIO.new
+      MiniPhone.normalize_stream(StringIO.new("1;4043841384\n"), output, column: 1, country: :US,
+                                                                        format: :dasherized_national, separator: ';')
+
+      expect(output.string).to eq("1;404-384-1384\n")
+    end
+
+    it 'maps paths' do
+      Tempfile.create('numbers') do |file|
+        file.write("4043841384\n" * 10_000)
+        file.flush
+        output = StringIO.new
+
+        stats = MiniPhone.normalize_stream(file.path, output, country: 'US')
+
+        expect(stats).to include(rows: 10_000, normalized: 10_000)
+        expect(output.string).to eq("+14043841384\n" * 10_000)
+      end
+    end
+
+    it 'matches parsing the numbers one by one' do
+      numbers = ['+44 1434 634996', '404-384-1384', '444', '+1 (800) FLOWERS', '']
+      output = StringIO.new
+      MiniPhone.normalize_stream(StringIO.new(numbers.join("\n")), output, country: 'US', format: :national)
+
+      expect(output.string.split("\n", -1)).to eq(numbers.map { |n| MiniPhone.parse(n, 'US').national.to_s })
+    end
+
+    it 'rejects unknown formats' do
+      expect { MiniPhone.normalize_stream(StringIO.new, StringIO.new, format: :nope) }.to raise_error(ArgumentError)
+    end
+  end
+
+  describe '.find_numbers' do
+    it 'finds the numbers with their character offsets' do
+      text = 'Appelez le ☎ 404-384-1384 ou +44 1434 634996, pas 12345.'
+      matches = MiniPhone.find_numbers(text, 'US')
+
+      expect(matches.map(&:raw_string)).to eq(['404-384-1384', '+44 1434 634996'])
+      expect(matches.map { |m| text[m.start...m.end] }).to eq(['404-384-1384', '+44 1434 634996'])
+      expect(matches.map { |m| m.phone_number.e164 }).to eq(['+14043841384', '+441434634996'])
+    end
+
+    it 'supports the leniency levels' do
+      text = 'Call 404 384 13 84'
+
+      expect(MiniPhone.find_numbers(text, 'US', leniency: :possible).size).to eq(1)
+      expect(MiniPhone.find_numbers(text, 'US', leniency: :exact_grouping)).to be_empty
+      expect { MiniPhone.find_numbers(text, 'US', leniency: :nope) }.to raise_error(ArgumentError)
+    end
+
+    it 'returns an empty array for nil' do
+      expect(MiniPhone.find_numbers(nil, 'US')).to eq([])
+    end
+  end
+
+  describe '.find_numbers_many' do
+    it 'scans every text' do
+      texts = ['Call 404-384-1384', nil, 'nothing here', 'UK: +44 1434 634996'] * 10
+
+      results = MiniPhone.find_numbers_many(texts, 'US', threads: 4)
+
+      expect(results.map { |matches| matches.map(&:raw_string) }).to eq(
+        [['404-384-1384'], [], [], ['+44 1434 634996']] * 10
+      )
+    end
+  end
+
+  describe '.e164' do
+    it 'returns the E164 formatted number' do
+      expect(MiniPhone.e164('404-384-1384', 'US')).to eq('+14043841384')
+      expect(MiniPhone.e164('+44 1434 634996')).to eq('+441434634996')
+    end
+
+    it 'returns nil for invalid numbers' do
+      expect(MiniPhone.e164('404-384-138', 'US')).to be_nil
+      expect(MiniPhone.e164('asdf', 'US')).to be_nil
+      expect(MiniPhone.e164(nil, 'US')).to be_nil
+    end
+
+    it 'uses the default country' do
+      old = MiniPhone.default_country
+      MiniPhone.default_country = 'GB'
+
+      expect(MiniPhone.e164('01434 634996')).to eq('+441434634996')
+    ensure
+      MiniPhone.default_country = old
+    end
+
+    it 'agrees with MiniPhone::PhoneNumber' do
+      ['404-384-1384', '+14043841384', '+1 242 357 1234', '01434 634996', '911', 'junk'].each do |input|
+        pn = MiniPhone::PhoneNumber.new(input, 'US')
+
+        expect(MiniPhone.e164(input, 'US')).to eq(pn.valid? ? pn.e164 : nil)
+      end
+    end
+  end
+
+  describe '.normalize' do
+    it 'formats valid numbers' do
+      expect(MiniPhone.normalize('404-384-1384', 'US', format: :national)).to eq('(404) 384-1384')
+      expect(MiniPhone.normalize('404-384-1384', 'US', format: :dasherized_national)).to eq('404-384-1384')
+      expect(MiniPhone.normalize('404-384-1384', 'US')).to eq('+14043841384')
+    end
+
+    it 'returns nil for invalid numbers' do
+      expect(MiniPhone.normalize('404-384-138', 'US', format: :national)).to be_nil
+    end
+
+    it 'rejects unknown formats' do
+      expect { MiniPhone.normalize('404-384-138', 'US', format: :nope) }.to raise_error(ArgumentError)
+    end
+  end
+
+  describe '.type' do
+    it 'returns the type of valid numbers' do
+      expect(MiniPhone.type('404-384-1384', 'US')).to eq(:fixed_line_or_mobile)
+      expect(MiniPhone.type('+1 (800) 221-1212')).to eq(:toll_free)
+    end
+
+    it 'returns nil for invalid numbers' do
+      expect(MiniPhone.type('404-384-138', 'US')).to be_nil
+    end
+  end
+
+  describe '.stats' do
+    around do |ex|
+      MiniPhone.reset_stats
+      MiniPhone.stats_enabled = true
+      ex.run
+    ensure
+      MiniPhone.stats_enabled = false
+      MiniPhone.reset_stats
+    end
+
+    it 'counts calls and time per phase and region' do
+      MiniPhone.valid_for_country?('404-384-1384', 'US')
+      MiniPhone.normalize('404-384-1384', 'US', format: :national)
+      MiniPhone.type('404-384-1384', 'US')
+
+      stats = MiniPhone.stats
+
+      expect(stats[:enabled]).to eq(true)
+      expect(stats[:phases].keys).to eq(%i[input parse validate type format])
+      expect(stats[:phases][:parse][:calls]).to be >= 3
+      expect(stats[:phases][:validate][:calls]).to be >= 3
+      expect(stats[:phases][:type][:calls]).to eq(1)
+      expect(stats[:phases][:format][:calls]).to eq(1)
+      expect(stats[:phases][:parse][:ns]).to be > 0
+      expect(stats[:regions].keys).to eq(['US'])
+    end
+
+    it 'does not count anything while disabled' do
+      MiniPhone.stats_enabled = false
+      MiniPhone.valid_for_country?('404-384-1384', 'US')
+
+      expect(MiniPhone.stats_enabled?).to eq(false)
+      expect(MiniPhone.stats[:phases].values.sum { |phase| phase[:calls] }).to eq(0)
+    end
+
+    it 'can be reset' do
+      MiniPhone.valid_for_country?('404-384-1384', 'US')
+      MiniPhone.reset_stats
+
+      expect(MiniPhone.stats[:phases][:parse]).to eq(calls: 0, ns: 0)
+      expect(MiniPhone.stats[:regions]).to eq({})
+    end
+  end
+
+  describe '.warmup!' do
+    it 'warms up the given regions' do
+      result = MiniPhone.warmup!(regions: ['US', :GB, '001'])
+
+      expect(result[:regions]).to eq(3)
+      expect(result[:seconds]).to be_a(Float)
+      expect(MiniPhone.e164('01434 634996', 'GB')).to eq('+441434634996')
+    end
+
+    it 'warms up every region by default' do
+      expect(MiniPhone.warmup!(threads: 4)[:regions]).to be > 200
+    end
+
+    it 'rejects unknown regions' do
+      expect { MiniPhone.warmup!(regions: ['XX']) }.to raise_error(ArgumentError, /XX/)
+      expect { MiniPhone.warmup!(regions: ['US'], threads: 0) }.to raise_error(ArgumentError)
+    end
+  end
+
+  describe '.restrict_regions' do
+    after { MiniPhone.restrict_regions(nil) }
+
+    it 'only accepts numbers from the allowed regions' do
+      report = MiniPhone.restrict_regions(['US', :GB])
+
+      expect(report[:regions]).to eq(2)
+      expect(report[:country_codes]).to eq(2)
+      expect(report[:excluded_metadata_bytes]).to be > report[:metadata_bytes]
+      expect(MiniPhone.restricted_regions).to eq(%w[US GB])
+      expect(MiniPhone.valid?('+1 404-384-1384')).to eq(true)
+      expect(MiniPhone.valid?('+44 1434 634996')).to eq(true)
+      expect(MiniPhone.valid?('+61 2 1234 5678')).to eq(false)
+      expect(MiniPhone.parse('+61 2 1234 5678')).to be_invalid
+      expect(MiniPhone.valid_many?(['+1 404-384-1384', '+61 2 1234 5678'])).to eq([true, false])
+    end
+
+    it 'tells apart regions sharing a country calling code' do
+      MiniPhone.restrict_regions(['US'])
+
+      expect(MiniPhone.valid?('+1 404-384-1384')).to eq(true)
+      expect(MiniPhone.valid?('+1 242 357 1234')).to eq(false)
+
+      MiniPhone.restrict_regions(%w[US BS])
+      expect(MiniPhone.valid?('+1 242 357 1234')).to eq(true)
+    end
+
+    it 'drops cached results' do
+      MiniPhone.cache_size = 10
+      expect(MiniPhone.valid_for_country?('+61 2 1234 5678', 'AU')).to eq(true)
+
+      MiniPhone.restrict_regions(['US'])
+      expect(MiniPhone.valid_for_country?('+61 2 1234 5678', 'AU')).to eq(false)
+    ensure
+      MiniPhone.cache_size = 0
+    end
+
+    it 'only warms up the allowed regions' do
+      MiniPhone.restrict_regions(%w[US CA])
+
+      expect(MiniPhone.warmup![:regions]).to eq(2)
+    end
+
+    it 'can be lifted' do
+      MiniPhone.restrict_regions(['US'])
+      report = MiniPhone.restrict_regions(nil)
+
+      expect(MiniPhone.restricted_regions).to be_nil
+      expect(report[:excluded_metadata_bytes]).to eq(0)
+      expect(MiniPhone.region_restriction_report).to eq(report)
+      expect(MiniPhone.valid?('+61 2 1234 5678')).to eq(true)
+    end
+
+    it 'rejects unknown regions' do
+      expect { MiniPhone.restrict_regions(['XX']) }.to raise_error(ArgumentError, /XX/)
+      expect { MiniPhone.restrict_regions([]) }.to raise_error(ArgumentError)
+      expect(MiniPhone.restricted_regions).to be_nil
+    end
   end
 end
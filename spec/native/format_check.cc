@@ -0,0 +1,162 @@
+// Checks the dasherized formats the extension slices out with its own digit
+// matchers against libphonenumber's FormatByPattern with the same formats, for
+// numbers generated for every country calling code in the metadata: every
+// length up to 17 digits, with every one to three digit prefix followed by
+// random digits, plus a format with an optional group that comes out empty.
+// Built and run by `rake spec:native`.
+//
+//   format_check [seed]
+//
+// Prints the numbers that come out differently and exits with 1 if there are
+// any.
+
+#include "compiled_metadata.h"
+#include "number_format.h"
+#include "phonenumbers/phonemetadata.pb.h"
+#include "phonenumbers/phonenumberutil.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+
+using namespace ::i18n::phonenumbers;
+
+static const int MAX_LENGTH = 17;
+
+static size_t checked = 0;
+static size_t mismatches = 0;
+
+static void check(const PhoneNumber &number) {
+  std::string actual;
+  std::string expected;
+
+  number_format(number, NUMBER_FORMAT_DASHERIZED_NATIONAL, &actual);
+  number_format_dasherized_reference(number, &expected);
+  checked++;
+
+  if (actual != expected) {
+    std::string e164;
+    PhoneNumberUtil::GetInstance()->Format(number, PhoneNumberUtil::E164, &e164);
+
+    if (mismatches++ < 50) {
+      printf("%s: %s, libphonenumber gives %s\n", e164.c_str(), actual.c_str(), expected.c_str());
+    }
+  }
+}
+
+// Puts a format with an optional group in front of the formats of calling
+// code 1, for numbers starting with 999. The metadata has none right now, but
+// both paths have to give it its dash when it comes out empty.
+static bool add_empty_group_format(PhoneMetadataCollection *collection) {
+  for (PhoneMetadata &metadata : *collection->mutable_metadata()) {
+    if (metadata.country_code() != 1 || !metadata.main_country_for_code()) {
+      continue;
+    }
+
+    NumberFormat *number_format = metadata.add_number_format();
+    number_format->set_pattern("(\\d{3})(\\d{0,2})(\\d{4})");
+    number_format->set_format("$1 $2 $3");
+    number_format->add_leading_digits_pattern("999");
+
+    for (int i = metadata.number_format_size() - 1; i > 0; i--) {
+      metadata.mutable_number_format()->SwapElements(i, i - 1);
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+// The number with the national significant number `digits`, leading zeros
+// included. False for all zeros, which don't make a number.
+static bool build_number(int country_code, const std::string &digits, PhoneNumber *number) {
+  size_t zeros = digits.find_first_not_of('0');
+
+  if (zeros == std::string::npos) {
+    return false;
+  }
+
+  number->Clear();
+  number->set_country_code(country_code);
+  number->set_national_number(std::stoull(digits));
+
+  if (zeros > 0) {
+    number->set_italian_leading_zero(true);
+  }
+
+  if (zeros > 1) {
+    number->set_number_of_leading_zeros(static_cast<int32_t>(zeros));
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv) {
+  std::mt19937_64 random(argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1234);
+  PhoneMetadataCollection collection;
+  std::set<int> country_codes;
+
+  if (!collection.ParseFromArray(metadata_get(), metadata_size())) {
+    fprintf(stderr, "couldn't parse libphonenumber's metadata\n");
+    return 1;
+  }
+
+  if (!add_empty_group_format(&collection)) {
+    fprintf(stderr, "no metadata for calling code 1\n");
+    return 1;
+  }
+
+  number_format_setup(collection);
+
+  PhoneNumber empty_group;
+  std::string reference;
+  build_number(1, "9991234", &empty_group);
+  number_format_dasherized_reference(empty_group, &reference);
+  check(empty_group);
+
+  if (reference != "999--1234") {
+    printf("+19991234: libphonenumber gives %s, expected 999--1234\n", reference.c_str());
+    mismatches++;
+  }
+
+  for (const PhoneMetadata &metadata : collection.metadata()) {
+    country_codes.insert(metadata.country_code());
+  }
+
+  for (int country_code : country_codes) {
+    PhoneNumber number;
+
+    for (int length = 1; length <= MAX_LENGTH; length++) {
+      int prefix_length = std::min(length, 3);
+      int prefixes = prefix_length == 1 ? 10 : prefix_length == 2 ? 100 : 1000;
+
+      for (int prefix = 0; prefix < prefixes; prefix++) {
+        std::string digits = std::to_string(prefix);
+        digits.insert(0, prefix_length - digits.size(), '0');
+
+        while (static_cast<int>(digits.size()) < length) {
+          digits.push_back(static_cast<char>('0' + random() % 10));
+        }
+
+        if (!build_number(country_code, digits, &number)) {
+          continue;
+        }
+
+        // Extensions are appended the same way for every format
+        if (prefix % 97 == 0) {
+          number.set_extension("12");
+        }
+
+        check(number);
+      }
+    }
+  }
+
+  printf("%zu numbers for %zu calling codes checked, %zu formatted differently\n", checked, country_codes.size(),
+         mismatches);
+
+  return mismatches == 0 ? 0 : 1;
+}
@@ -2,6 +2,8 @@
 
 require 'bundler/setup'
 require 'mini_phone'
+require 'stringio'
+require 'tempfile'
 
 RSpec.configure do |config|
   # Enable flags like --only-failures and --next-failure